@@ -0,0 +1,95 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+// Microbenchmark for the element id to pixel conversion. Times the plain scalar palette loop
+// against every vector kernel the CPU supports on a 4K-sized world, for the flat element
+// palette and for the shaded one the game draws with.
+//
+
+#include <raylib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "cell.h"
+#include "color_kernel.h"
+
+int main(int argc, char* argv[]) {
+  int width = 3840;
+  int height = 2160;
+  int iterations = 200;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string_view arg = argv[i];
+    if (arg == "--width") {
+      width = std::max(std::atoi(argv[i + 1]), 1);
+    } else if (arg == "--height") {
+      height = std::max(std::atoi(argv[i + 1]), 1);
+    } else if (arg == "--iterations") {
+      iterations = std::max(std::atoi(argv[i + 1]), 1);
+    }
+  }
+
+  struct Palette {
+    const char* name;
+    const Color* colors;
+    int size;
+  };
+  const Palette palettes[] = {
+      {"element", Cell::kBuiltinColors.data(), static_cast<int>(Cell::Element::kCount)},
+      {"shaded", Cell::GetShadePalette(), Cell::kShadePaletteSize},
+  };
+
+  std::printf("%dx%d, %d iterations\n", width, height, iterations);
+  std::vector<uint8_t> ids(static_cast<size_t>(width) * height);
+  std::vector<Color> reference(ids.size());
+  std::vector<Color> out(ids.size());
+  for (const Palette& palette : palettes) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> entry(0, palette.size - 1);
+    for (uint8_t& id : ids) {
+      id = static_cast<uint8_t>(entry(rng));
+    }
+
+    // what WorldTexture did before the kernel existed
+    const auto scalarStart = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; iteration++) {
+      for (size_t i = 0; i < ids.size(); i++) {
+        reference[i] = palette.colors[ids[i]];
+      }
+    }
+    const double scalarNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - scalarStart).count();
+
+    const double pixels = static_cast<double>(ids.size()) * iterations;
+    std::printf("\n%s palette, %d entries\n", palette.name, palette.size);
+    std::printf("%-14s %12s %12s %10s\n", "kernel", "ns/pixel", "ms/frame", "speedup");
+    std::printf("%-14s %12.3f %12.3f %10.2f\n", "scalar loop", scalarNs / pixels, scalarNs / iterations * 1e-6, 1.0);
+
+    for (ColorKernel::Isa isa : {ColorKernel::Isa::kScalar, ColorKernel::Isa::kSsse3, ColorKernel::Isa::kAvx2}) {
+      const ColorKernel kernel(palette.colors, palette.size, isa);
+      if (kernel.GetIsa() != isa) {
+        continue; // not supported here
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      for (int iteration = 0; iteration < iterations; iteration++) {
+        for (int y = 0; y < height; y++) {
+          kernel.ConvertRow(&ids[static_cast<size_t>(y) * width], &out[static_cast<size_t>(y) * width], width);
+        }
+      }
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+      if (std::memcmp(out.data(), reference.data(), out.size() * sizeof(Color)) != 0) {
+        std::fprintf(stderr, "%s kernel output differs from the scalar loop\n", ColorKernel::GetIsaName(isa));
+        return 1;
+      }
+      std::printf("%-14s %12.3f %12.3f %10.2f\n", ColorKernel::GetIsaName(isa), ns / pixels, ns / iterations * 1e-6,
+                  scalarNs / ns);
+    }
+  }
+  return 0;
+}
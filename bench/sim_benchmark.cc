@@ -0,0 +1,450 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+// Headless simulation benchmark. Builds an AutomataMatrix without opening a window, runs
+// preset scenes for a fixed number of ticks and reports throughput and tick time percentiles.
+// Every cell storage layout is compiled in, so they can be compared on the same scenes, and
+// the built-in element kernels can be compared against the table driven fallback. The sparse
+// world runs the same scenes walled into a box, plus one spread over 64-bit coordinates, and
+// can page idle chunks out to a memory-mapped file.
+//
+
+#include <raylib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "automata_matrix.h"
+#include "sparse_world.h"
+
+namespace {
+
+template <typename Matrix>
+struct Scene {
+  const char* name;
+  // lays out the starting world
+  void (*setup)(Matrix& world);
+  // runs before every tick, outside the timed region
+  void (*step)(Matrix& world, int tick, std::mt19937& rng);
+};
+
+template <typename Matrix>
+void FillRect(Matrix& world, int x0, int y0, int x1, int y1, Cell::Element element) {
+  x0 = std::max(x0, 1);
+  y0 = std::max(y0, 1);
+  x1 = std::min(x1, world.GetWidth() - 2);
+  y1 = std::min(y1, world.GetHeight() - 2);
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      world.SetCell(x, y, element);
+    }
+  }
+}
+
+// A block of sand in the middle of the sky that collapses into a heap.
+template <typename Matrix>
+void SetupSandPile(Matrix& world) {
+  const int w = world.GetWidth();
+  const int h = world.GetHeight();
+  FillRect(world, w / 4, h / 2, 3 * w / 4, h - h / 8, Cell::Element::kSand);
+}
+
+// A stone tank that a row of spouts keeps pouring water into.
+template <typename Matrix>
+void SetupWaterTank(Matrix& world) {
+  const int w = world.GetWidth();
+  const int h = world.GetHeight();
+  FillRect(world, w / 8, h / 8, 7 * w / 8, h / 8 + 2, Cell::Element::kStone);
+  FillRect(world, w / 8, h / 8, w / 8 + 2, h / 2, Cell::Element::kStone);
+  FillRect(world, 7 * w / 8 - 2, h / 8, 7 * w / 8, h / 2, Cell::Element::kStone);
+}
+
+template <typename Matrix>
+void StepWaterTank(Matrix& world, int, std::mt19937&) {
+  const int w = world.GetWidth();
+  const int y = world.GetHeight() - 2;
+  for (int x = w / 4; x < 3 * w / 4; x += 16) {
+    world.SetCell(x, y, Cell::Element::kWater);
+  }
+}
+
+// Sand and water raining down at random over a few stone ledges.
+template <typename Matrix>
+void SetupMixedRain(Matrix& world) {
+  const int w = world.GetWidth();
+  const int h = world.GetHeight();
+  for (int i = 1; i < 4; i++) {
+    const int y = i * h / 5;
+    const int x = (i % 2) ? w / 8 : w / 2;
+    FillRect(world, x, y, x + 3 * w / 8, y + 1, Cell::Element::kStone);
+  }
+}
+
+template <typename Matrix>
+void StepMixedRain(Matrix& world, int, std::mt19937& rng) {
+  const int w = world.GetWidth();
+  const int y = world.GetHeight() - 2;
+  std::uniform_int_distribution<int> column(1, w - 2);
+  for (int i = 0; i < w / 32; i++) {
+    world.SetCell(column(rng), y, (i % 2) ? Cell::Element::kWater : Cell::Element::kSand);
+  }
+}
+
+// A tall block of water let go at one end of an empty basin, which it has to level out across.
+template <typename Matrix>
+void SetupReservoir(Matrix& world) {
+  const int w = world.GetWidth();
+  const int h = world.GetHeight();
+  FillRect(world, 1, 1, w / 4, 3 * h / 4, Cell::Element::kWater);
+}
+
+template <typename Matrix>
+void NoStep(Matrix&, int, std::mt19937&) {}
+
+// Mixed rain with the middle ledge kept red hot, so heat spreads through whatever lands on it.
+template <typename Matrix>
+void StepHotLedges(Matrix& world, const int tick, std::mt19937& rng) {
+  StepMixedRain(world, tick, rng);
+  const int w = world.GetWidth();
+  const int y = 2 * world.GetHeight() / 5;
+  for (int x = w / 2; x <= std::min(w / 2 + 3 * w / 8, w - 2); x++) {
+    world.SetHeat(x, y, 255);
+    world.SetHeat(x, y + 1, 255);
+  }
+}
+
+template <typename Matrix>
+const Scene<Matrix> kScenes[] = {
+    {"sand_pile", SetupSandPile<Matrix>, NoStep<Matrix>},
+    {"water_tank", SetupWaterTank<Matrix>, StepWaterTank<Matrix>},
+    {"mixed_rain", SetupMixedRain<Matrix>, StepMixedRain<Matrix>},
+    {"reservoir", SetupReservoir<Matrix>, NoStep<Matrix>},
+};
+
+// Scenes that need heat, which only the dense world simulates.
+template <typename Matrix>
+const Scene<Matrix> kHeatScenes[] = {
+    {"hot_ledges", SetupMixedRain<Matrix>, StepHotLedges<Matrix>},
+};
+
+// The scenes' view of a SparseWorld: a width x height box far from the origin, so the 64-bit
+// coordinates get used.
+class SparseBox {
+ public:
+  static constexpr int64_t kOrigin = int64_t{1} << 40;
+
+  SparseBox(const int width, const int height) : width(width), height(height) {}
+
+  // Walls the box in with bedrock, like an AutomataMatrix's border.
+  void Enclose() {
+    for (int x = 0; x < width; x++) {
+      SetCell(x, 0, Cell::Element::kBedrock);
+      SetCell(x, height - 1, Cell::Element::kBedrock);
+    }
+    for (int y = 0; y < height; y++) {
+      SetCell(0, y, Cell::Element::kBedrock);
+      SetCell(width - 1, y, Cell::Element::kBedrock);
+    }
+  }
+
+  [[nodiscard]] int GetWidth() const { return width; }
+  [[nodiscard]] int GetHeight() const { return height; }
+  void SetCell(const int x, const int y, const Cell::Element element) { world.SetCell(kOrigin + x, kOrigin + y, element); }
+  void Update() { world.Update(); }
+  [[nodiscard]] int GetAwakeChunkCount() const { return world.GetAwakeChunkCount(); }
+
+  SparseWorld world;
+
+ private:
+  int width;
+  int height;
+};
+
+// Sixteen stone basins of sand and water, each a trillion cells from the next.
+void SetupFarIslands(SparseBox& box) {
+  constexpr int64_t kSpacing = int64_t{1} << 40;
+  for (int64_t i = -8; i < 8; i++) {
+    const int64_t x0 = i * kSpacing;
+    const int64_t y0 = -i * kSpacing;
+    for (int64_t x = 0; x < 256; x++) {
+      box.world.SetCell(x0 + x, y0, Cell::Element::kStone);
+    }
+    for (int64_t y = 0; y < 200; y++) {
+      box.world.SetCell(x0, y0 + y, Cell::Element::kStone);
+      box.world.SetCell(x0 + 255, y0 + y, Cell::Element::kStone);
+    }
+    for (int64_t y = 100; y < 200; y++) {
+      for (int64_t x = 20; x < 236; x++) {
+        box.world.SetCell(x0 + x, y0 + y, x < 128 ? Cell::Element::kSand : Cell::Element::kWater);
+      }
+    }
+  }
+}
+
+// A camera that moves to the next island every 64 ticks and drops a grain of sand there.
+void StepFarIslands(SparseBox& box, const int tick, std::mt19937&) {
+  constexpr int64_t kSpacing = int64_t{1} << 40;
+  if (tick % 64 != 0) {
+    return;
+  }
+  const int64_t i = (tick / 64) % 16 - 8;
+  const int64_t x0 = i * kSpacing;
+  const int64_t y0 = -i * kSpacing;
+  box.world.Prefetch(x0, y0, x0 + 255, y0 + 199);
+  box.world.SetCell(x0 + 128, y0 + 199, Cell::Element::kSand);
+}
+
+const Scene<SparseBox> kSparseScenes[] = {
+    {"far_islands", SetupFarIslands, StepFarIslands},
+};
+
+struct Options {
+  std::string scene = "all";
+  std::string layout = "default";
+  std::string dispatch = "auto"; // auto, generic or both
+  bool fastFlow = true;
+  bool columnFall = true;
+  bool skipSettled = true;
+  std::string elements; // compiled-in element properties unless set
+  int ticks = 1000;
+  int width = 1024;
+  int height = 768;
+  int threads = 0; // 0 runs the sequential update, anything else the checkerboard update
+  int pageIdle = 0; // > 0 pages sparse chunks idle for that many ticks out to pageFile
+  std::string pageFile = "sim_benchmark_chunks.bin";
+  unsigned int seed = 1;
+};
+
+void PrintUsage(const char* program) {
+  std::printf("usage: %s [--scene all|sand_pile|water_tank|mixed_rain|reservoir|hot_ledges|far_islands]\n"
+              "          [--layout default|all|soa|aos|packed|sparse]\n"
+              "          [--dispatch auto|generic|both] [--flow fast|step] [--fall column|grain]\n"
+              "          [--settled skip|visit] [--ticks N] [--width N] [--height N] [--threads N]\n"
+              "          [--seed N] [--elements path] [--page-idle N] [--page-file path]\n", program);
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--scene") {
+      options.scene = value;
+    } else if (arg == "--layout") {
+      options.layout = value;
+    } else if (arg == "--dispatch") {
+      options.dispatch = value;
+    } else if (arg == "--flow") {
+      options.fastFlow = std::string_view(value) != "step";
+    } else if (arg == "--settled") {
+      options.skipSettled = std::string_view(value) != "visit";
+    } else if (arg == "--fall") {
+      options.columnFall = std::string_view(value) != "grain";
+    } else if (arg == "--elements") {
+      options.elements = value;
+    } else if (arg == "--ticks") {
+      options.ticks = std::max(std::atoi(value), 1);
+    } else if (arg == "--width") {
+      options.width = std::max(std::atoi(value), 3);
+    } else if (arg == "--height") {
+      options.height = std::max(std::atoi(value), 3);
+    } else if (arg == "--threads") {
+      options.threads = std::max(std::atoi(value), 0);
+    } else if (arg == "--page-idle") {
+      options.pageIdle = std::max(std::atoi(value), 0);
+    } else if (arg == "--page-file") {
+      options.pageFile = value;
+    } else if (arg == "--seed") {
+      options.seed = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs a scene on a freshly set up world and prints its row.
+template <typename Matrix>
+void TimeScene(const Scene<Matrix>& scene, const Options& options, Matrix& world, const char* layout, const char* dispatch) {
+  std::mt19937 rng(options.seed);
+  scene.setup(world);
+
+  std::vector<double> tickNs(options.ticks);
+  for (int tick = 0; tick < options.ticks; tick++) {
+    scene.step(world, tick, rng);
+    const auto start = std::chrono::steady_clock::now();
+    world.Update();
+    const auto end = std::chrono::steady_clock::now();
+    tickNs[tick] = std::chrono::duration<double, std::nano>(end - start).count();
+  }
+
+  double totalNs = 0.0;
+  for (double ns : tickNs) {
+    totalNs += ns;
+  }
+  std::ranges::sort(tickNs);
+  const double p50 = tickNs[tickNs.size() / 2];
+  const double p99 = tickNs[std::min(tickNs.size() - 1, tickNs.size() * 99 / 100)];
+  const double cells = static_cast<double>(options.width) * options.height;
+
+  std::printf("%-12s %-8s %-8s %8d %12.1f %10.3f %10.3f %10.3f %8d\n",
+              scene.name,
+              layout,
+              dispatch,
+              options.ticks,
+              options.ticks / (totalNs * 1e-9),
+              totalNs / options.ticks / cells,
+              p50 * 1e-6,
+              p99 * 1e-6,
+              world.GetAwakeChunkCount());
+}
+
+template <typename Layout>
+void RunScene(const Scene<BasicAutomataMatrix<Layout>>& scene, const Options& options, const bool generic) {
+  BasicAutomataMatrix<Layout> world(options.width, options.height);
+  world.SetSeed(options.seed);
+  world.SetGenericDispatch(generic);
+  world.SetFastFlow(options.fastFlow);
+  world.SetColumnFall(options.columnFall);
+  world.SetSkipSettled(options.skipSettled);
+  if (options.threads > 0) {
+    world.SetUpdateMode(AutomataMatrix::UpdateMode::kCheckerboard, options.threads);
+  }
+  TimeScene(scene, options, world, Layout::kName, generic || !Cell::HasBuiltinBehavior() ? "generic" : "builtin");
+}
+
+void RunSparseScene(const Scene<SparseBox>& scene, const Options& options, const bool enclose) {
+  SparseBox box(options.width, options.height);
+  box.world.SetSeed(options.seed);
+  if (options.pageIdle > 0) {
+    box.world.EnablePaging(options.pageFile, options.pageIdle);
+  }
+  if (enclose) {
+    box.Enclose();
+  }
+  TimeScene(scene, options, box, "sparse", "generic");
+
+  std::printf("%-12s %-8s %zu chunks (%zu resident), %.3f MB", "", "sparse",
+              box.world.GetChunkCount(), box.world.GetResidentChunkCount(),
+              box.world.GetChunkMemory() / (1024.0 * 1024.0));
+  if (enclose) {
+    const double cells = static_cast<double>(options.width) * options.height;
+    std::printf(" (dense grid %.3f MB)", cells * SparseWorld::Layout::kBytesPerCell / (1024.0 * 1024.0));
+  }
+  std::printf("\n");
+
+  if (options.pageIdle > 0) {
+    const SparseWorld::PagingStats& stats = box.world.GetPagingStats();
+    std::printf("%-12s %-8s %llu page-ins avg %.1f us max %.1f us, %llu page-outs avg %.1f us max %.1f us\n",
+                "", "sparse",
+                static_cast<unsigned long long>(stats.pageIns),
+                stats.pageIns ? stats.pageInNs / stats.pageIns * 1e-3 : 0.0, stats.maxPageInNs * 1e-3,
+                static_cast<unsigned long long>(stats.pageOuts),
+                stats.pageOuts ? stats.pageOutNs / stats.pageOuts * 1e-3 : 0.0, stats.maxPageOutNs * 1e-3);
+  }
+}
+
+// Runs the selected scenes on the sparse world, returns false if none matched.
+bool RunSparseScenes(const Options& options) {
+  if (options.threads > 0) {
+    std::printf("%-12s %-8s sequential only\n", "", "sparse");
+  }
+  bool found = false;
+  for (const Scene<SparseBox>& scene : kScenes<SparseBox>) {
+    if (options.scene == "all" || options.scene == scene.name) {
+      RunSparseScene(scene, options, true);
+      found = true;
+    }
+  }
+  for (const Scene<SparseBox>& scene : kSparseScenes) {
+    if (options.scene == "all" || options.scene == scene.name) {
+      RunSparseScene(scene, options, false);
+      found = true;
+    }
+  }
+  return found;
+}
+
+// Runs the selected scenes with one layout, returns false if none matched.
+template <typename Layout>
+bool RunScenes(const Options& options) {
+  bool found = false;
+  const auto run = [&options, &found](const Scene<BasicAutomataMatrix<Layout>>& scene) {
+    if (options.scene == "all" || options.scene == scene.name) {
+      if (options.dispatch != "generic") {
+        RunScene<Layout>(scene, options, false);
+      }
+      if (options.dispatch != "auto") {
+        RunScene<Layout>(scene, options, true);
+      }
+      found = true;
+    }
+  };
+  std::ranges::for_each(kScenes<BasicAutomataMatrix<Layout>>, run);
+  std::ranges::for_each(kHeatScenes<BasicAutomataMatrix<Layout>>, run);
+  if (found) {
+    // a clearing pass reads and writes every flag; it used to run every tick
+    const double cells = static_cast<double>(options.width) * options.height;
+    const double perPassMb = 2.0 * cells * Layout::kUpdatedStride / (1024.0 * 1024.0);
+    std::printf("%-12s %-8s update flag reset %.3f MB/tick, was %.3f MB/tick (one pass per %d ticks)\n",
+                "", Layout::kName, perPassMb / Layout::kGenerations, perPassMb, Layout::kGenerations);
+  }
+  return found;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  SetTraceLogLevel(LOG_WARNING);
+  if (!options.elements.empty()) {
+    Cell::LoadElements(options.elements);
+  }
+  if (options.dispatch != "auto" && options.dispatch != "generic" && options.dispatch != "both") {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::printf("world %dx%d, %s update, %d thread(s), %s liquid flow, %s falls, %s settled cells, seed %u\n",
+              options.width, options.height,
+              options.threads > 0 ? "checkerboard" : "sequential",
+              std::max(options.threads, 1), options.fastFlow ? "fast" : "step",
+              options.columnFall ? "column" : "grain", options.skipSettled ? "skip" : "visit", options.seed);
+  std::printf("%-12s %-8s %-8s %8s %12s %10s %10s %10s %8s\n",
+              "scene", "layout", "dispatch", "ticks", "ticks/sec", "ns/cell", "p50 ms", "p99 ms", "awake");
+
+  const bool all = options.layout == "all";
+  bool found = false;
+  if (options.layout == "default") {
+    found = RunScenes<AutomataMatrix::LayoutType>(options);
+  }
+  if (all || options.layout == SoaCellLayout::kName) {
+    found |= RunScenes<SoaCellLayout>(options);
+  }
+  if (all || options.layout == AosCellLayout::kName) {
+    found |= RunScenes<AosCellLayout>(options);
+  }
+  if (all || options.layout == PackedCellLayout::kName) {
+    found |= RunScenes<PackedCellLayout>(options);
+  }
+  if (all || options.layout == "sparse") {
+    found |= RunSparseScenes(options);
+  }
+  if (!found) {
+    std::fprintf(stderr, "unknown scene or layout: %s / %s\n", options.scene.c_str(), options.layout.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+// Times world snapshots: how long a save holds up the simulation (the capture), how long the
+// background write takes, how big the file is and how long it takes to load back.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "automata_matrix.h"
+#include "snapshot.h"
+
+namespace {
+
+double MsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A sand bank, a lake and some stone ledges under open sky, so much of the world is air.
+void LayOutScene(AutomataMatrix& world) {
+  const int width = world.GetWidth();
+  const int height = world.GetHeight();
+  for (int y = 1; y < height - 1; y++) {
+    for (int x = 1; x < width - 1; x++) {
+      if (y < height / 4 && x < width / 2) {
+        world.SetCell(x, y, Cell::Element::kSand);
+      } else if (y < height / 5 && x >= width / 2) {
+        world.SetCell(x, y, Cell::Element::kWater);
+      } else if (y % 97 == 0 && x % 211 < 60) {
+        world.SetCell(x, y, Cell::Element::kStone);
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  int width = 2048;
+  int height = 2048;
+  int ticks = 100;
+  int iterations = 10;
+  std::string path = "snapshot_benchmark.snap";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string_view arg = argv[i];
+    if (arg == "--width") {
+      width = std::max(std::atoi(argv[i + 1]), 3);
+    } else if (arg == "--height") {
+      height = std::max(std::atoi(argv[i + 1]), 3);
+    } else if (arg == "--ticks") {
+      ticks = std::max(std::atoi(argv[i + 1]), 0);
+    } else if (arg == "--iterations") {
+      iterations = std::max(std::atoi(argv[i + 1]), 1);
+    } else if (arg == "--file") {
+      path = argv[i + 1];
+    }
+  }
+
+  AutomataMatrix world{width, height};
+  world.SetSeed(1);
+  LayOutScene(world);
+  for (int tick = 0; tick < ticks; tick++) {
+    world.Update();
+  }
+  const uint64_t hash = world.HashCells();
+
+  // each save captures on this thread and writes on another, as the game does; the first one
+  // also allocates the capture buffer, so it is left out
+  SnapshotWriter writer;
+  writer.Save(world, path);
+  writer.Wait();
+  double captureTotal = 0.0;
+  double captureMax = 0.0;
+  double saveTotal = 0.0;
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    const auto start = std::chrono::steady_clock::now();
+    writer.Save(world, path);
+    writer.Wait();
+    saveTotal += MsSince(start);
+    captureTotal += writer.GetCaptureMs();
+    captureMax = std::max(captureMax, writer.GetCaptureMs());
+  }
+
+  // the part of a save that runs in the background before anything is written
+  Snapshot snapshot;
+  snapshot.Capture(world);
+  const auto unpackStart = std::chrono::steady_clock::now();
+  snapshot.Unpack();
+  const double unpackMs = MsSince(unpackStart);
+  const std::vector<char> file = [&path] {
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    std::vector<char> bytes;
+    if (in) {
+      char buffer[1 << 16];
+      for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), in)) > 0;) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+      }
+      std::fclose(in);
+    }
+    return bytes;
+  }();
+
+  AutomataMatrix loaded{width, height};
+  double loadTotal = 0.0;
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    const auto start = std::chrono::steady_clock::now();
+    Snapshot::Load(path, loaded);
+    loadTotal += MsSince(start);
+  }
+  std::remove(path.c_str());
+
+  const double rawBytes = static_cast<double>(width) * height * 3;
+  const int chunks = ((width + AutomataMatrix::kChunkSize - 1) / AutomataMatrix::kChunkSize) *
+                     ((height + AutomataMatrix::kChunkSize - 1) / AutomataMatrix::kChunkSize);
+  std::printf("%dx%d after %d ticks, %d iterations\n", width, height, ticks, iterations);
+  std::printf("chunks saved   %zu of %d\n", snapshot.GetChunkCount(), chunks);
+  std::printf("file size      %.1f KB (%.1fx smaller than the raw cells)\n", file.size() / 1024.0,
+              file.empty() ? 0.0 : rawBytes / file.size());
+  std::printf("capture        avg %.2f ms  max %.2f ms (time the simulation is held up)\n",
+              captureTotal / iterations, captureMax);
+  std::printf("unpack         %.2f ms (background)\n", unpackMs);
+  std::printf("capture+write  avg %.2f ms\n", saveTotal / iterations);
+  std::printf("load           avg %.2f ms\n", loadTotal / iterations);
+  std::printf("round trip     %s\n",
+              loaded.HashCells() == hash && loaded.GetTick() == world.GetTick() ? "ok" : "MISMATCH");
+  return loaded.HashCells() == hash ? 0 : 1;
+}
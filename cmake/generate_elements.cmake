@@ -0,0 +1,104 @@
+# Turns resources/elements.json into a header of constexpr element tables, so the element set
+# and its properties are known at compile time (see src/cell.h).
+#
+# Script mode: cmake -DINPUT=<elements.json> -DOUTPUT=<element_tables.h> -P generate_elements.cmake
+
+file(READ ${INPUT} json)
+string(JSON count LENGTH ${json} elements)
+if (count EQUAL 0)
+    message(FATAL_ERROR "${INPUT}: no elements")
+endif()
+math(EXPR last "${count} - 1")
+
+set(enumerators "")
+set(types "")
+set(weights "")
+set(viscosity "")
+set(conductivity "")
+set(colors "")
+set(names "")
+foreach (i RANGE ${last})
+    string(JSON index GET ${json} elements ${i} index)
+    string(JSON type GET ${json} elements ${i} type)
+    string(JSON weight GET ${json} elements ${i} weight)
+    string(JSON viscous GET ${json} elements ${i} viscosity)
+    string(JSON conducts GET ${json} elements ${i} conductivity)
+    string(JSON color GET ${json} elements ${i} color)
+    string(JSON name GET ${json} elements ${i} name)
+
+    if (NOT index EQUAL i)
+        message(FATAL_ERROR "${INPUT}: element ${i} has index ${index}, elements must be listed in index order")
+    endif()
+    if (type LESS 0 OR type GREATER 5)
+        message(FATAL_ERROR "${INPUT}: element ${name} has unknown type ${type}")
+    endif()
+    if (conducts LESS 0 OR conducts GREATER 64)
+        message(FATAL_ERROR "${INPUT}: element ${name} conductivity ${conducts} is not 0-64")
+    endif()
+    if (NOT color MATCHES "^#[0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F][0-9a-fA-F]$")
+        message(FATAL_ERROR "${INPUT}: element ${name} colour ${color} is not #rrggbb")
+    endif()
+
+    # snake_case name -> kCamelCase enumerator
+    set(enumerator "k")
+    string(REPLACE "_" ";" words ${name})
+    foreach (word ${words})
+        string(SUBSTRING ${word} 0 1 head)
+        string(SUBSTRING ${word} 1 -1 tail)
+        string(TOUPPER ${head} head)
+        string(APPEND enumerator "${head}${tail}")
+    endforeach()
+
+    string(SUBSTRING ${color} 1 2 r)
+    string(SUBSTRING ${color} 3 2 g)
+    string(SUBSTRING ${color} 5 2 b)
+    math(EXPR r "0x${r}")
+    math(EXPR g "0x${g}")
+    math(EXPR b "0x${b}")
+
+    string(APPEND enumerators "  ${enumerator},\n")
+    string(APPEND types " ${type},")
+    string(APPEND weights " ${weight},")
+    string(APPEND viscosity " ${viscous},")
+    string(APPEND conductivity " ${conducts},")
+    string(APPEND colors "    {${r}, ${g}, ${b}, 255}, // ${name}\n")
+    string(APPEND names " \"${name}\",")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp "\
+// Generated from resources/elements.json by cmake/generate_elements.cmake, do not edit.
+
+#ifndef RAYLIB_SAND_SIM_GENERATED_ELEMENT_TABLES_H_
+#define RAYLIB_SAND_SIM_GENERATED_ELEMENT_TABLES_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace element_tables {
+
+enum class Element : uint8_t {
+${enumerators}  kCount,
+};
+
+inline constexpr size_t kCount = ${count};
+
+// Cell::Type values
+inline constexpr std::array<uint8_t, kCount> kTypes = {${types} };
+inline constexpr std::array<int, kCount> kWeights = {${weights} };
+inline constexpr std::array<int, kCount> kViscosity = {${viscosity} };
+// 256ths of a heat difference passed to each neighbour per tick, 0-64
+inline constexpr std::array<uint8_t, kCount> kConductivity = {${conductivity} };
+// r, g, b, a
+inline constexpr std::array<std::array<uint8_t, 4>, kCount> kColors = {{
+${colors}}};
+inline constexpr std::array<std::string_view, kCount> kNames = {${names} };
+
+} // namespace element_tables
+
+#endif //RAYLIB_SAND_SIM_GENERATED_ELEMENT_TABLES_H_
+")
+# only touch the header when it changes, so editing the json's formatting rebuilds nothing
+configure_file(${OUTPUT}.tmp ${OUTPUT} COPYONLY)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,617 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "automata_matrix.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+AutomataMatrixBase::AutomataMatrixBase(int width, int height)
+    : width(width), height(height), settledStride((width + 63) / 64),
+      settled(static_cast<size_t>(height) * settledStride), flowReach(width) {
+  // every chunk starts awake so the first tick looks at the whole world
+  chunksX = (width + kChunkSize - 1) / kChunkSize;
+  chunksY = (height + kChunkSize - 1) / kChunkSize;
+  chunks = std::vector<Chunk>(chunksX * chunksY);
+  chunkPopulation = std::vector<std::atomic<int>>(chunks.size() * element_tables::kCount);
+  for (int cy = 0; cy < chunksY; cy++) {
+    for (int cx = 0; cx < chunksX; cx++) {
+      Chunk& chunk = chunks[cy*chunksX + cx];
+      chunk.current = {
+          cx * kChunkSize,
+          cy * kChunkSize,
+          std::min((cx + 1) * kChunkSize, width) - 1,
+          std::min((cy + 1) * kChunkSize, height) - 1
+      };
+      chunk.changed = chunk.current;
+    }
+  }
+}
+
+void AutomataMatrixBase::SetUpdateMode(const UpdateMode mode, const int threadCount) {
+  updateMode = mode;
+  flowReach = mode == UpdateMode::kCheckerboard ? kMaxFlow : width;
+  if (mode == UpdateMode::kCheckerboard) {
+    threadPool = std::make_unique<ThreadPool>(std::max(threadCount, 1));
+  } else {
+    threadPool.reset();
+  }
+}
+
+int AutomataMatrixBase::GetAwakeChunkCount() const {
+  return static_cast<int>(std::ranges::count_if(chunks, [](const Chunk& chunk) { return !chunk.current.Empty(); }));
+}
+
+void AutomataMatrixBase::TakeChangedRegions(std::vector<DirtyRect>& regions) {
+  for (Chunk& chunk : chunks) {
+    // also pick up SetCell calls made since the last tick
+    DirtyRect region = chunk.changed;
+    region.Include(chunk.next.Load());
+    if (!region.Empty()) {
+      regions.push_back(region);
+    }
+    chunk.changed = DirtyRect{};
+  }
+}
+
+void AutomataMatrixBase::FindHeatChunks() {
+  heatChunks.clear();
+  for (int cy = 0; cy < chunksY; cy++) {
+    for (int cx = 0; cx < chunksX; cx++) {
+      // particles carry their heat too, only into the next chunk unless SwapCells marked the
+      // chunk they reached hot
+      bool nearHeat = false;
+      for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, chunksY - 1); ny++) {
+        for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, chunksX - 1); nx++) {
+          nearHeat |= chunks[ny*chunksX + nx].hot;
+        }
+      }
+      if (nearHeat) {
+        heatChunks.push_back(cy*chunksX + cx);
+      }
+    }
+  }
+}
+
+void AutomataMatrixBase::WakeAll() {
+  for (std::atomic<uint64_t>& word : settled) {
+    word.store(0, std::memory_order_relaxed);
+  }
+  for (int cy = 0; cy < chunksY; cy++) {
+    for (int cx = 0; cx < chunksX; cx++) {
+      chunks[cy*chunksX + cx].next.Include(
+          cx * kChunkSize,
+          cy * kChunkSize,
+          std::min((cx + 1) * kChunkSize, width) - 1,
+          std::min((cy + 1) * kChunkSize, height) - 1);
+    }
+  }
+}
+
+void AutomataMatrixBase::FinishTick() {
+  // whatever changed this tick is what gets looked at next tick, everything else sleeps
+  for (Chunk& chunk : chunks) {
+    chunk.current = chunk.next.Take();
+    chunk.changed.Include(chunk.current);
+  }
+  tick++;
+}
+
+// A changed cell can set anything in its 3x3 neighbourhood moving, so grow the next dirty rect of
+// every chunk that neighbourhood overlaps. This is also how a sleeping chunk gets woken by its neighbour.
+void AutomataMatrixBase::WakeCell(const int pos) {
+  const int x = pos % width;
+  const int y = pos / width;
+  WakeRect(x, y, x, y);
+}
+
+void AutomataMatrixBase::WakeRect(int x0, int y0, int x1, int y1) {
+  x0 = std::max(x0 - 1, 0);
+  y0 = std::max(y0 - 1, 0);
+  x1 = std::min(x1 + 1, width - 1);
+  y1 = std::min(y1 + 1, height - 1);
+  for (int y = y0; y <= y1; y++) {
+    for (int word = x0 / 64; word <= x1 / 64; word++) {
+      const int first = std::max(x0, word * 64) - word * 64;
+      const int last = std::min(x1, word * 64 + 63) - word * 64;
+      const uint64_t bits = (~0ull >> (63 - last)) & (~0ull << first);
+      std::atomic<uint64_t>& target = settled[y*settledStride + word];
+      // the plain load first keeps the common nothing-settled case free of read-modify-writes
+      if (target.load(std::memory_order_relaxed) & bits) {
+        target.fetch_and(~bits, std::memory_order_relaxed);
+      }
+    }
+  }
+  for (int cy = y0 / kChunkSize; cy <= y1 / kChunkSize; cy++) {
+    for (int cx = x0 / kChunkSize; cx <= x1 / kChunkSize; cx++) {
+      chunks[cy*chunksX + cx].next.Include(
+          std::max(x0, cx * kChunkSize),
+          std::max(y0, cy * kChunkSize),
+          std::min(x1, (cx + 1) * kChunkSize - 1),
+          std::min(y1, (cy + 1) * kChunkSize - 1));
+    }
+  }
+}
+
+void AutomataMatrixBase::AddPopulation(const int chunk, const std::array<int, element_tables::kCount>& delta) {
+  for (size_t element = 0; element < delta.size(); element++) {
+    if (delta[element] != 0) {
+      population[element] += delta[element];
+      chunkPopulation[chunk * element_tables::kCount + element].fetch_add(delta[element], std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename Layout>
+BasicAutomataMatrix<Layout>::BasicAutomataMatrix(int width, int height)
+    : AutomataMatrixBase(width, height), cells(width * height) {
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      if (x == 0 || x == width - 1 || y == 0 || y == height - 1) {
+        cells.SetElement(y*width + x, Cell::Element::kBedrock);
+      } else {
+        cells.SetElement(y*width + x, Cell::Element::kAir);
+      }
+
+      cells.SetHeat(y*width + x, 0);
+      cells.SetShade(y*width + x, 0);
+      cells.SetUpdated(y*width + x, 0);
+    }
+  }
+
+  std::vector<int> perChunk;
+  CountPopulation(population, perChunk);
+  for (size_t i = 0; i < perChunk.size(); i++) {
+    chunkPopulation[i].store(perChunk[i], std::memory_order_relaxed);
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::CountPopulation(std::array<int64_t, element_tables::kCount>& totals,
+                                                  std::vector<int>& perChunk) const {
+  totals.fill(0);
+  perChunk.assign(chunks.size() * element_tables::kCount, 0);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const auto element = static_cast<size_t>(cells.GetElement(y*width + x));
+      totals[element]++;
+      perChunk[((y / kChunkSize) * chunksX + x / kChunkSize) * element_tables::kCount + element]++;
+    }
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::VerifyPopulation() const {
+  std::array<int64_t, element_tables::kCount> totals;
+  std::vector<int> perChunk;
+  CountPopulation(totals, perChunk);
+  for (size_t element = 0; element < totals.size(); element++) {
+    const std::string name = Cell::GetName(static_cast<Cell::Element>(element));
+    if (totals[element] != population[element]) {
+      throw std::runtime_error("Population of " + name + " is " + std::to_string(population[element]) +
+                               " but the world holds " + std::to_string(totals[element]) +
+                               " at tick " + std::to_string(tick));
+    }
+    for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+      const size_t i = chunk * element_tables::kCount + element;
+      if (perChunk[i] != chunkPopulation[i].load(std::memory_order_relaxed)) {
+        throw std::runtime_error("Population of " + name + " in chunk " + std::to_string(chunk) + " is " +
+                                 std::to_string(chunkPopulation[i].load(std::memory_order_relaxed)) +
+                                 " but it holds " + std::to_string(perChunk[i]) + " at tick " + std::to_string(tick));
+      }
+    }
+  }
+}
+
+template <typename Layout>
+int BasicAutomataMatrix<Layout>::FillSpan(const int y, int x0, int x1, const Cell::Element element) {
+  x0 = std::max(x0, 0);
+  x1 = std::min(x1, width - 1);
+  if (y < 0 || y >= height || x0 > x1) {
+    return 0;
+  }
+  // a chunk's slice of the span at a time, so its counts are touched once
+  int written = 0;
+  for (int start = x0; start <= x1;) {
+    const int end = std::min(x1, (start / kChunkSize + 1) * kChunkSize - 1);
+    std::array<int, element_tables::kCount> delta{};
+    for (int pos = y*width + start; pos <= y*width + end; pos++) {
+      const Cell::Element previous = cells.GetElement(pos);
+      if (previous != Cell::Element::kBedrock) {
+        if (previous != element) {
+          delta[static_cast<size_t>(previous)]--;
+          delta[static_cast<size_t>(element)]++;
+          cells.SetShade(pos, PickShade(pos, element));
+          cells.SetElement(pos, element);
+        }
+        written++;
+      }
+    }
+    AddPopulation((y / kChunkSize) * chunksX + start / kChunkSize, delta);
+    start = end + 1;
+  }
+  WakeRect(x0, y, x1, y);
+  return written;
+}
+
+template <typename Layout>
+uint64_t BasicAutomataMatrix<Layout>::HashCells() const {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int pos = 0; pos < width * height; pos++) {
+    for (const uint8_t byte : {static_cast<uint8_t>(cells.GetElement(pos)), cells.GetHeat(pos), cells.GetShade(pos)}) {
+      hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+  }
+  return hash;
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::ApplyGravity(int pos, int weight, const int direction, const bool liquid) {
+  // a particle that has already moved into a cell still to be visited this tick stays put
+  if (cells.GetUpdated(pos) == generation) {
+    return;
+  }
+  if (columnFall && FallColumn<kBuiltin>(pos, weight)) {
+    return;
+  }
+  const int start = pos;
+  bool spread = false;
+  while (weight-- != 0) {
+    const int below = Below(pos);
+    const int directionA = direction ? BelowRight(pos) : BelowLeft(pos);
+    const int directionB = direction ? BelowLeft(pos) : BelowRight(pos);
+    if (IsEmpty<kBuiltin>(below)) {
+      SwapCells(pos, below);
+      pos = below;
+    } else if (IsEmpty<kBuiltin>(directionA)) {
+      SwapCells(pos, directionA);
+      pos = directionA;
+    } else if (IsEmpty<kBuiltin>(directionB)) {
+      SwapCells(pos, directionB);
+      pos = directionB;
+    } else {
+      if (liquid) {
+        spread = ApplySpread<kBuiltin>(pos, weight, direction);
+      }
+      break;
+    }
+  }
+  cells.SetUpdated(pos, generation);
+  // whether it can move only depends on its neighbours, so it can't until one of them changes
+  if (pos == start && !spread && skipSettled) {
+    Settle(pos);
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+bool BasicAutomataMatrix<Layout>::FallColumn(const int pos, const int weight) {
+  // only a straight drop: every cell the bottom particle would pass through must be free
+  const int x = pos % width;
+  const int y = pos / width;
+  if (weight == 0 || y - weight < 1) {
+    return false;
+  }
+  for (int i = 1; i <= weight; i++) {
+    if (!IsEmpty<kBuiltin>(pos - i * width)) {
+      return false;
+    }
+  }
+
+  // the run of the same element stacked on top, kept inside the chunk so a checkerboard thread
+  // only moves particles it owns
+  const Cell::Element element = cells.GetElement(pos);
+  const int chunkTop = std::min((y / kChunkSize + 1) * kChunkSize, height) - 1;
+  int top = y;
+  while (top < chunkTop && cells.GetElement((top + 1) * width + x) == element &&
+         cells.GetUpdated((top + 1) * width + x) != generation) {
+    top++;
+  }
+  if (top == y) {
+    return false;
+  }
+
+  // each particle would have fallen weight cells straight down in turn; shift the run in one go
+  const int chunkBottom = (y / kChunkSize) * kChunkSize;
+  for (int row = y; row <= top; row++) {
+    const int from = row * width + x;
+    if (row - weight < chunkBottom) {
+      SwapPopulation(GetChunkIndex(from), GetChunkIndex(from - weight * width), element,
+                     cells.GetElement(from - weight * width));
+    }
+    cells.Swap(from, from - weight * width);
+    cells.SetUpdated(from - weight * width, generation);
+  }
+  WakeRect(x, y - weight, x, top);
+  return true;
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+bool BasicAutomataMatrix<Layout>::ApplySpread(int& pos, int spread, const int direction) {
+  if (fastFlow) {
+    // one move to the bottom of the surface's slope instead of a few cells a tick
+    int target = FindDownhill<kBuiltin>(pos, direction ? 1 : -1);
+    if (target < 0) {
+      target = FindDownhill<kBuiltin>(pos, direction ? -1 : 1);
+    }
+    if (target >= 0) {
+      SwapCells(pos, target);
+      pos = target;
+      return true;
+    }
+  }
+  bool moved = false;
+  while (spread-- != 0) {
+    const int directionA = direction ? Right(pos) : Left(pos);
+    const int directionB = direction ? Left(pos) : Right(pos);
+    if (IsEmpty<kBuiltin>(directionA)) {
+      SwapCells(pos, directionA);
+      pos = directionA;
+      moved = true;
+    } else if (IsEmpty<kBuiltin>(directionB)) {
+      SwapCells(pos, directionB);
+      pos = directionB;
+      moved = true;
+    }
+  }
+  return moved;
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+int BasicAutomataMatrix<Layout>::FindDownhill(const int pos, const int step) const {
+  // the world's bedrock border ends every run
+  int cell = pos;
+  int lowest = -1;
+  for (int steps = 0; steps < flowReach; steps++) {
+    cell += step;
+    if (!IsEmpty<kBuiltin>(cell)) {
+      break;
+    }
+    if (IsEmpty<kBuiltin>(Below(cell))) {
+      // the edge of a real drop, where it gets to fall the normal way
+      if (IsEmpty<kBuiltin>(Below(Below(cell)))) {
+        return cell;
+      }
+      // one cell down a gentle slope, carry on along the lower surface
+      cell = Below(cell);
+      lowest = cell;
+      steps++;
+    }
+  }
+  return lowest;
+}
+
+template <typename Layout>
+template <Cell::Element kElement>
+void BasicAutomataMatrix<Layout>::UpdateBuiltin(const int pos, const int direction) {
+  constexpr Cell::Type kType = Cell::GetBuiltinType(kElement);
+  constexpr int kWeight = Cell::GetBuiltinWeight(kElement);
+  // solids and empty cells never move; fire and gas have no rules yet
+  if constexpr (kType == Cell::Type::kPowder || kType == Cell::Type::kLiquid) {
+    ApplyGravity<true>(pos, kWeight, direction, kType == Cell::Type::kLiquid);
+  } else if (skipSettled) {
+    Settle(pos);
+  }
+}
+
+template <typename Layout>
+template <size_t... kElements>
+void BasicAutomataMatrix<Layout>::DispatchBuiltin(const int pos, const Cell::Element element, const int direction,
+                                                  std::index_sequence<kElements...>) {
+  // expands to one comparison per element, which the compiler folds into a switch
+  (void)((element == static_cast<Cell::Element>(kElements)
+          && (UpdateBuiltin<static_cast<Cell::Element>(kElements)>(pos, direction), true)) || ...);
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::UpdateGeneric(const int pos, const Cell::Element element, const int direction) {
+  switch (Cell::GetType(element)) {
+    case Cell::Type::kPowder:
+      ApplyGravity<false>(pos, Cell::GetWeight(element), direction, false);
+      break;
+    case Cell::Type::kLiquid:
+      ApplyGravity<false>(pos, Cell::GetWeight(element), direction, true);
+      break;
+    default:
+      if (skipSettled) {
+        Settle(pos);
+      }
+      break;
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::UpdateCell(const int pos) {
+  // which way to try first is picked per cell, so there is no frame-wide left/right bias
+  const int direction = RandomBit(pos);
+  const Cell::Element element = cells.GetElement(pos);
+  if constexpr (kBuiltin) {
+    DispatchBuiltin(pos, element, direction, std::make_index_sequence<static_cast<size_t>(Cell::Element::kCount)>());
+  } else {
+    UpdateGeneric(pos, element, direction);
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::Update() {
+  tickKey = Random::Hash(seed, tick);
+  generation = static_cast<uint8_t>(tick % Layout::kGenerations + 1);
+  // picked once per tick so the per-cell loops carry no check
+  const bool builtin = Cell::HasBuiltinBehavior() && !genericDispatch;
+  if (updateMode == UpdateMode::kCheckerboard) {
+    builtin ? UpdateCheckerboard<true>() : UpdateCheckerboard<false>();
+  } else {
+    builtin ? UpdateSequential<true>() : UpdateSequential<false>();
+  }
+
+  DiffuseHeat();
+  FinishTick();
+  // every generation has been handed out, start again from a clean slate
+  if (generation == Layout::kGenerations) {
+    cells.ClearUpdated();
+  }
+
+  if (verifyPopulation) {
+    VerifyPopulation();
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::UpdateSequential() {
+  // walk the world bottom to top a row at a time, but only visit the dirty part of awake chunks
+  for (int cy = 0; cy < chunksY; cy++) {
+    const int rowEnd = std::min((cy + 1) * kChunkSize, height);
+    for (int y = cy * kChunkSize; y < rowEnd; y++) {
+      for (int cx = 0; cx < chunksX; cx++) {
+        const DirtyRect& rect = chunks[cy*chunksX + cx].current;
+        if (y < rect.minY || y > rect.maxY) {
+          continue;
+        }
+        UpdateRow<kBuiltin>(y, rect.minX, rect.maxX);
+      }
+    }
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::UpdateRow(const int y, const int x0, const int x1) {
+  if (!skipSettled) {
+    for (int x = x0; x <= x1; x++) {
+      UpdateCell<kBuiltin>(y*width + x);
+    }
+    return;
+  }
+  // jump straight to the next cell that isn't settled; the word is reread after every visit,
+  // since a visit can wake cells further along
+  const std::atomic<uint64_t>& word = settled[y*settledStride + x0 / 64];
+  const int base = x0 / 64 * 64;
+  for (int x = x0; x <= x1; x++) {
+    const uint64_t awake = ~word.load(std::memory_order_relaxed) & (~0ull << (x - base));
+    if (awake == 0) {
+      break;
+    }
+    x = base + std::countr_zero(awake);
+    if (x > x1) {
+      break;
+    }
+    UpdateCell<kBuiltin>(y*width + x);
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::UpdateCheckerboard() {
+  // Chunks sharing a phase are a whole chunk apart, so the threads working on them never touch
+  // the same cells. Particles that leave a chunk land in a neighbour owned by a later phase.
+  for (int phase = 0; phase < 4; phase++) {
+    phaseChunks.clear();
+    for (int cy = phase / 2; cy < chunksY; cy += 2) {
+      for (int cx = phase % 2; cx < chunksX; cx += 2) {
+        if (!chunks[cy*chunksX + cx].current.Empty()) {
+          phaseChunks.push_back(cy*chunksX + cx);
+        }
+      }
+    }
+    threadPool->ParallelFor(static_cast<int>(phaseChunks.size()), [this](int task) {
+      UpdateChunk<kBuiltin>(phaseChunks[task]);
+    });
+  }
+}
+
+template <typename Layout>
+template <bool kBuiltin>
+void BasicAutomataMatrix<Layout>::UpdateChunk(const int index) {
+  const DirtyRect& rect = chunks[index].current;
+  for (int y = rect.minY; y <= rect.maxY; y++) {
+    UpdateRow<kBuiltin>(y, rect.minX, rect.maxX);
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::DiffuseHeat() {
+  FindHeatChunks();
+  if (heatChunks.empty()) {
+    return;
+  }
+  heatScratch.resize(heatChunks.size() * kChunkSize * kChunkSize);
+
+  // every chunk reads its neighbours' edges, so work out all of them before storing any
+  const int count = static_cast<int>(heatChunks.size());
+  if (threadPool) {
+    threadPool->ParallelFor(count, [this](int task) { DiffuseChunk(task); });
+    threadPool->ParallelFor(count, [this](int task) { StoreHeat(task); });
+  } else {
+    for (int task = 0; task < count; task++) {
+      DiffuseChunk(task);
+    }
+    for (int task = 0; task < count; task++) {
+      StoreHeat(task);
+    }
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::DiffuseChunk(const int task) {
+  // The chunk's heat and conductivities are gathered into a tile with a one cell border, so
+  // the kernel sees plain rows whatever the layout. Past the world's edge nothing conducts.
+  constexpr int kStride = kChunkSize + 2;
+  alignas(32) uint8_t heat[kStride * kStride];
+  alignas(32) uint8_t conductivity[kStride * kStride];
+  const uint8_t* table = Cell::GetConductivityTable();
+
+  const int cx = heatChunks[task] % chunksX;
+  const int cy = heatChunks[task] / chunksX;
+  const int x0 = cx * kChunkSize;
+  const int y0 = cy * kChunkSize;
+  const int x1 = std::min(x0 + kChunkSize, width);
+  const int y1 = std::min(y0 + kChunkSize, height);
+  std::fill(std::begin(heat), std::end(heat), 0);
+  std::fill(std::begin(conductivity), std::end(conductivity), 0);
+  for (int y = std::max(y0 - 1, 0); y < std::min(y1 + 1, height); y++) {
+    for (int x = std::max(x0 - 1, 0); x < std::min(x1 + 1, width); x++) {
+      const int tile = (y - y0 + 1) * kStride + (x - x0 + 1);
+      heat[tile] = cells.GetHeat(y*width + x);
+      conductivity[tile] = table[static_cast<size_t>(cells.GetElement(y*width + x))];
+    }
+  }
+
+  uint8_t* out = &heatScratch[static_cast<size_t>(task) * kChunkSize * kChunkSize];
+  for (int y = 0; y < y1 - y0; y++) {
+    const int center = (y + 1) * kStride + 1;
+    heatKernel.DiffuseRow(heat + center, conductivity + center, kStride, out + y * kChunkSize, x1 - x0);
+  }
+}
+
+template <typename Layout>
+void BasicAutomataMatrix<Layout>::StoreHeat(const int task) {
+  const int cx = heatChunks[task] % chunksX;
+  const int cy = heatChunks[task] / chunksX;
+  const int x0 = cx * kChunkSize;
+  const int y0 = cy * kChunkSize;
+  const int x1 = std::min(x0 + kChunkSize, width);
+  const int y1 = std::min(y0 + kChunkSize, height);
+  const uint8_t* in = &heatScratch[static_cast<size_t>(task) * kChunkSize * kChunkSize];
+
+  uint8_t hot = 0;
+  for (int y = y0; y < y1; y++) {
+    const uint8_t* row = in + (y - y0) * kChunkSize;
+    for (int x = x0; x < x1; x++) {
+      cells.SetHeat(y*width + x, row[x - x0]);
+      hot |= row[x - x0];
+    }
+  }
+  chunks[heatChunks[task]].hot = hot != 0;
+}
+
+template class BasicAutomataMatrix<SoaCellLayout>;
+template class BasicAutomataMatrix<AosCellLayout>;
+template class BasicAutomataMatrix<PackedCellLayout>;
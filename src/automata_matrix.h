@@ -0,0 +1,478 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_AUTOMATA_MATRIX_H_
+#define RAYLIB_SAND_SIM_SRC_AUTOMATA_MATRIX_H_
+
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cell.h"
+#include "cell_layout.h"
+#include "heat_kernel.h"
+#include "random.h"
+#include "thread_pool.h"
+
+// Layout independent half of the world: size, neighbour arithmetic, chunk activity tracking
+// and the thread pool. BasicAutomataMatrix adds the cells and the rules that move them.
+class AutomataMatrixBase {
+public:
+  // Side length of the square chunks the world is split into for activity tracking.
+  static constexpr int kChunkSize = 64;
+
+  // Checkerboard updates rely on a particle (and the neighbours it looks at) never reaching
+  // from one chunk across its neighbour into the next chunk of the same phase.
+  static_assert(2 * (Cell::kMaxWeight + 1) < kChunkSize);
+
+  // Furthest a liquid slides along its surface in one checkerboard tick, counting steps down. Added
+  // to a sideways fall it still has to stay inside the neighbouring chunk. Sequential updates
+  // let it slide the whole width of the world.
+  static constexpr int kMaxFlow = kChunkSize / 2 - Cell::kMaxWeight - 2;
+  static_assert(kMaxFlow > 0 && 2 * (Cell::kMaxWeight + kMaxFlow + 1) < kChunkSize);
+
+  enum class UpdateMode {
+    kSequential,   // one pass over the world, bottom to top
+    kCheckerboard, // chunks in four 2x2 phases, each phase spread over a thread pool
+  };
+
+  // Inclusive cell rectangle, empty while minX > maxX.
+  struct DirtyRect {
+    int minX = INT_MAX;
+    int minY = INT_MAX;
+    int maxX = INT_MIN;
+    int maxY = INT_MIN;
+
+    [[nodiscard]] inline bool Empty() const { return minX > maxX; }
+    [[nodiscard]] inline int Width() const { return maxX - minX + 1; }
+    [[nodiscard]] inline int Height() const { return maxY - minY + 1; }
+
+    inline void Include(const int x0, const int y0, const int x1, const int y1) {
+      minX = std::min(minX, x0);
+      minY = std::min(minY, y0);
+      maxX = std::max(maxX, x1);
+      maxY = std::max(maxY, y1);
+    }
+
+    inline void Include(const DirtyRect& other) {
+      Include(other.minX, other.minY, other.maxX, other.maxY);
+    }
+  };
+
+  [[nodiscard]] inline int GetWidth()  const { return width; }
+  [[nodiscard]] inline int GetHeight() const { return height; }
+
+  [[nodiscard]] inline int Above     (const int pos) const { return pos + width; }
+  [[nodiscard]] inline int Below     (const int pos) const { return pos - width; }
+  [[nodiscard]] inline int Right     (const int pos) const { return pos + 1; }
+  [[nodiscard]] inline int Left      (const int pos) const { return pos - 1; }
+  [[nodiscard]] inline int AboveRight(const int pos) const { return pos + width + 1; }
+  [[nodiscard]] inline int AboveLeft (const int pos) const { return pos + width - 1; }
+  [[nodiscard]] inline int BelowRight(const int pos) const { return pos - width + 1; }
+  [[nodiscard]] inline int BelowLeft (const int pos) const { return pos - width - 1; }
+
+  // Switches how Update walks the world. The checkerboard mode produces the same world for
+  // any thread count, so one thread is a valid (if slow) way to run it.
+  void SetUpdateMode(UpdateMode mode, int threadCount = 1);
+
+  [[nodiscard]] inline UpdateMode GetUpdateMode() const { return updateMode; }
+
+  // Liquid that can't fall follows its surface downhill and moves straight to the bottom of the
+  // slope or the edge of the next drop, so big bodies level out quickly. Off, it only creeps its
+  // weight in cells a tick, the way it used to.
+  inline void SetFastFlow(const bool value) { fastFlow = value; }
+  [[nodiscard]] inline bool GetFastFlow() const { return fastFlow; }
+
+  // A particle dropping straight down takes the stack of the same element resting on it along,
+  // in one move per particle instead of one per cell fallen. Off, every particle falls on its
+  // own, which ends up in the same place for a straight drop.
+  inline void SetColumnFall(const bool value) { columnFall = value; }
+  [[nodiscard]] inline bool GetColumnFall() const { return columnFall; }
+
+  // A cell whose visit changes nothing (a particle that fails to move, air, a solid) is marked
+  // settled and skipped until something next to it changes, so the still parts of a busy chunk
+  // cost next to nothing. Off, every cell in a
+  // chunk's dirty rectangle is visited; the world comes out the same either way.
+  inline void SetSkipSettled(const bool value) { skipSettled = value; }
+  [[nodiscard]] inline bool GetSkipSettled() const { return skipSettled; }
+  [[nodiscard]] inline int GetThreadCount() const { return threadPool ? threadPool->GetThreadCount() : 1; }
+
+  // Number of completed Update calls.
+  [[nodiscard]] inline uint64_t GetTick() const { return tick; }
+  // Picks the count back up, e.g. when a snapshot is loaded.
+  inline void SetTick(const uint64_t value) { tick = value; }
+
+  // Every random choice the rules make is derived from the seed, the tick and the cell, so a
+  // run can be reproduced exactly, whatever the update mode's thread count.
+  inline void SetSeed(const uint64_t value) { seed = value; }
+  [[nodiscard]] inline uint64_t GetSeed() const { return seed; }
+
+  [[nodiscard]] int GetAwakeChunkCount() const;
+
+  // Chunks the last tick's heat diffusion ran over.
+  [[nodiscard]] inline int GetHeatChunkCount() const { return static_cast<int>(heatChunks.size()); }
+
+  [[nodiscard]] inline int GetChunkCount() const { return static_cast<int>(chunks.size()); }
+
+  // Cells holding element, in the whole world or in one chunk. Both are kept up to date as cells
+  // are written and as particles move from chunk to chunk, so asking costs nothing.
+  [[nodiscard]] inline int64_t GetPopulation(const Cell::Element element) const {
+    return population[static_cast<size_t>(element)];
+  }
+
+  [[nodiscard]] inline int GetChunkPopulation(const int chunk, const Cell::Element element) const {
+    return chunkPopulation[chunk * element_tables::kCount + static_cast<size_t>(element)].load(std::memory_order_relaxed);
+  }
+
+  // Recounts every cell after each tick and throws if the kept counts have drifted. As slow as
+  // it sounds; for debugging.
+  inline void SetVerifyPopulation(const bool value) { verifyPopulation = value; }
+  [[nodiscard]] inline bool GetVerifyPopulation() const { return verifyPopulation; }
+
+  // Appends a rectangle per chunk covering every cell changed since the last call, and starts a
+  // new round. Meant for whoever mirrors the world elsewhere, e.g. the renderer's texture. The
+  // rectangles come from the wake-up bookkeeping, so they can overshoot by a cell.
+  void TakeChangedRegions(std::vector<DirtyRect>& regions);
+
+  // Marks every cell for a visit next tick and for the next TakeChangedRegions, e.g. after the
+  // whole world was replaced.
+  void WakeAll();
+
+protected:
+  AutomataMatrixBase(int width, int height);
+
+  // DirtyRect that several update threads can grow at once.
+  struct AtomicDirtyRect {
+    std::atomic<int> minX = INT_MAX;
+    std::atomic<int> minY = INT_MAX;
+    std::atomic<int> maxX = INT_MIN;
+    std::atomic<int> maxY = INT_MIN;
+
+    inline void Include(const int x0, const int y0, const int x1, const int y1) {
+      StoreMin(minX, x0);
+      StoreMin(minY, y0);
+      StoreMax(maxX, x1);
+      StoreMax(maxY, y1);
+    }
+
+    // Only called between ticks.
+    [[nodiscard]] DirtyRect Load() const {
+      return {
+          minX.load(std::memory_order_relaxed),
+          minY.load(std::memory_order_relaxed),
+          maxX.load(std::memory_order_relaxed),
+          maxY.load(std::memory_order_relaxed)
+      };
+    }
+
+    // Returns the rectangle and resets it to empty. Only called between ticks.
+    DirtyRect Take() {
+      return {
+          minX.exchange(INT_MAX, std::memory_order_relaxed),
+          minY.exchange(INT_MAX, std::memory_order_relaxed),
+          maxX.exchange(INT_MIN, std::memory_order_relaxed),
+          maxY.exchange(INT_MIN, std::memory_order_relaxed)
+      };
+    }
+
+    // the plain load first keeps the common already-covered case free of read-modify-writes
+    static inline void StoreMin(std::atomic<int>& target, const int value) {
+      int current = target.load(std::memory_order_relaxed);
+      while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    static inline void StoreMax(std::atomic<int>& target, const int value) {
+      int current = target.load(std::memory_order_relaxed);
+      while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+  };
+
+  struct Chunk {
+    DirtyRect current;       // cells to visit this tick
+    AtomicDirtyRect next;    // cells touched so far this tick, visited next tick
+    DirtyRect changed;       // cells changed by past ticks since the last TakeChangedRegions
+    bool hot = false;        // may hold cells above ambient heat
+  };
+
+  [[nodiscard]] inline int GetChunkIndex(const int pos) const {
+    return (pos / width / kChunkSize) * chunksX + (pos % width) / kChunkSize;
+  }
+
+  // Collects the hot chunks and their neighbours, which heat can spread into, into heatChunks.
+  void FindHeatChunks();
+
+  // Hands this tick's changes over to the next tick and advances the tick counter.
+  void FinishTick();
+
+  void WakeCell(int pos);
+  // Wakes the rectangle's cells and their neighbours, inclusive, and unsettles them.
+  void WakeRect(int x0, int y0, int x1, int y1);
+
+  // Adds delta, indexed by element, to the world's and chunk's populations.
+  void AddPopulation(int chunk, const std::array<int, element_tables::kCount>& delta);
+
+  // first used to be in chunk1 and second in chunk2, and they have traded places.
+  inline void SwapPopulation(const int chunk1, const int chunk2, const Cell::Element first, const Cell::Element second) {
+    if (first == second) {
+      return;
+    }
+    std::atomic<int>* counts1 = &chunkPopulation[chunk1 * element_tables::kCount];
+    std::atomic<int>* counts2 = &chunkPopulation[chunk2 * element_tables::kCount];
+    counts1[static_cast<size_t>(first)].fetch_sub(1, std::memory_order_relaxed);
+    counts2[static_cast<size_t>(first)].fetch_add(1, std::memory_order_relaxed);
+    counts2[static_cast<size_t>(second)].fetch_sub(1, std::memory_order_relaxed);
+    counts1[static_cast<size_t>(second)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline void Settle(const int pos) {
+    const int x = pos % width;
+    settled[pos / width * settledStride + x / 64].fetch_or(1ull << (x % 64), std::memory_order_relaxed);
+  }
+
+  // One random bit for the cell at pos this tick.
+  [[nodiscard]] inline int RandomBit(const int pos) const {
+    return static_cast<int>(Random::Hash(tickKey, static_cast<uint64_t>(pos)) >> 63);
+  }
+
+  // Shade for a particle of element placed at pos now. Empty cells are all shade 0, which keeps
+  // them uniform for snapshots and hashes.
+  [[nodiscard]] inline uint8_t PickShade(const int pos, const Cell::Element element) const {
+    if (Cell::GetType(element) == Cell::Type::kEmpty) {
+      return 0;
+    }
+    return static_cast<uint8_t>(Random::Hash(tickKey, static_cast<uint64_t>(pos)) & (Cell::kShadeCount - 1));
+  }
+
+  int width;
+  int height;
+
+  uint64_t tick = 0;
+  uint64_t seed = 0;
+  uint64_t tickKey = 0; // seed and tick hashed together once per tick
+
+  int chunksX;
+  int chunksY;
+  std::vector<Chunk> chunks;
+
+  // Cells of each element, in total and per chunk (element_tables::kCount per chunk). Particles
+  // only ever trade places during a tick, so the totals hold still and only moves between
+  // chunks touch the per chunk counts, from whichever thread makes them.
+  std::array<int64_t, element_tables::kCount> population{};
+  std::vector<std::atomic<int>> chunkPopulation;
+  bool verifyPopulation = false;
+
+  // One bit per cell, set while the particle there is settled. Each row starts on a new word, so
+  // a word holds one chunk's slice of a row; the atomics are for wakes reaching into the chunk
+  // next door, which a thread on the far side can be waking at the same time.
+  static_assert(kChunkSize == 64);
+  int settledStride;
+  std::vector<std::atomic<uint64_t>> settled;
+
+  UpdateMode updateMode = UpdateMode::kSequential;
+  bool fastFlow = true;
+  bool columnFall = true;
+  bool skipSettled = true;
+  int flowReach; // how far liquid looks for a drop, see kMaxFlow
+  std::unique_ptr<ThreadPool> threadPool;
+  std::vector<int> phaseChunks;
+
+  HeatKernel heatKernel;
+  std::vector<int> heatChunks;
+  std::vector<uint8_t> heatScratch; // each heat chunk's next heat, kChunkSize^2 bytes apiece
+};
+
+// The world grid. Layout picks how the per-cell state is stored (see cell_layout.h); the
+// update rules are the same for all of them.
+template <typename Layout>
+class BasicAutomataMatrix : public AutomataMatrixBase {
+public:
+  using LayoutType = Layout;
+
+  BasicAutomataMatrix(int width = 400, int height = 300);
+
+  [[nodiscard]] inline Cell::Element GetCell(const int pos) const { return cells.GetElement(pos); }
+  [[nodiscard]] inline Cell::Element GetCell(const int x, const int y) const { return cells.GetElement(y*width + x); }
+
+  // Elements of count cells starting at (x, y), read through scratch if the layout needs to.
+  [[nodiscard]] inline const Cell::Element* ReadElements(const int x, const int y, const int count, Cell::Element* scratch) const {
+    return cells.ReadElements(y*width + x, count, scratch);
+  }
+
+  // Shades of count cells starting at (x, y), the same way.
+  [[nodiscard]] inline const uint8_t* ReadShades(const int x, const int y, const int count, uint8_t* scratch) const {
+    return cells.ReadShades(y*width + x, count, scratch);
+  }
+
+  // A cell changing element gets a new shade; writing the element it already holds keeps the old
+  // one, so a brush held still doesn't flicker.
+  void SetCell(const int pos, const Cell::Element element) {
+    const Cell::Element previous = cells.GetElement(pos);
+    if (previous != element) {
+      std::array<int, element_tables::kCount> delta{};
+      delta[static_cast<size_t>(previous)]--;
+      delta[static_cast<size_t>(element)]++;
+      AddPopulation(GetChunkIndex(pos), delta);
+      cells.SetShade(pos, PickShade(pos, element));
+    }
+    cells.SetElement(pos, element);
+    WakeCell(pos);
+  }
+
+  void SetCell(const int x, const int y, const Cell::Element element) {
+    SetCell(y*width + x, element);
+  }
+
+  [[nodiscard]] inline uint8_t GetHeat(const int pos) const { return cells.GetHeat(pos); }
+
+  // Heat spreads out each tick through the elements' conductivities and fades back to 0, the
+  // ambient temperature. Only chunks holding heat, and their neighbours, pay for it.
+  void SetHeat(const int pos, const uint8_t heat) {
+    cells.SetHeat(pos, heat);
+    chunks[GetChunkIndex(pos)].hot |= heat != 0;
+  }
+
+  void SetHeat(const int x, const int y, const uint8_t heat) {
+    SetHeat(y*width + x, heat);
+  }
+
+  [[nodiscard]] inline uint8_t GetShade(const int pos) const { return cells.GetShade(pos); }
+
+  // Overwrites everything about a cell without waking it, e.g. when loading a snapshot. Follow
+  // a batch of these with WakeAll.
+  void SetCellState(const int pos, const Cell::Element element, const uint8_t heat, const uint8_t shade) {
+    const Cell::Element previous = cells.GetElement(pos);
+    if (previous != element) {
+      std::array<int, element_tables::kCount> delta{};
+      delta[static_cast<size_t>(previous)]--;
+      delta[static_cast<size_t>(element)]++;
+      AddPopulation(GetChunkIndex(pos), delta);
+    }
+    cells.SetElement(pos, element);
+    cells.SetShade(pos, shade);
+    cells.SetUpdated(pos, 0);
+    SetHeat(pos, heat);
+  }
+
+  // The raw state of every cell, Layout::kBytesPerCell each, in one copy.
+  inline void CopyCellsTo(uint8_t* out) const { cells.CopyTo(out); }
+
+  void SwapCells(const int pos1, const int pos2) {
+    const int x1 = pos1 % width;
+    const int y1 = pos1 / width;
+    const int x2 = pos2 % width;
+    const int y2 = pos2 / width;
+    const int chunkX1 = x1 / kChunkSize;
+    const int chunkY1 = y1 / kChunkSize;
+    const int chunkX2 = x2 / kChunkSize;
+    const int chunkY2 = y2 / kChunkSize;
+    if (chunkX1 != chunkX2 || chunkY1 != chunkY2) {
+      SwapPopulation(GetChunkIndex(pos1), GetChunkIndex(pos2), cells.GetElement(pos1), cells.GetElement(pos2));
+      // Heat diffusion only reaches one chunk past the hot ones, so heat carried further (only
+      // sequential fast flow goes that far, on a single thread) makes its new chunk hot.
+      if (std::abs(chunkX1 - chunkX2) > 1 || std::abs(chunkY1 - chunkY2) > 1) {
+        chunks[GetChunkIndex(pos2)].hot |= cells.GetHeat(pos1) != 0;
+        chunks[GetChunkIndex(pos1)].hot |= cells.GetHeat(pos2) != 0;
+      }
+    }
+    // shades travel with the particles
+    cells.Swap(pos1, pos2);
+    WakeRect(x1, y1, x1, y1);
+    WakeRect(x2, y2, x2, y2);
+  }
+
+  void SwapCells(const int x1, const int y1, const int x2, const int y2) {
+    SwapCells(y1*width + x1, y2*width + x2);
+  }
+
+  // Sets cells x0 to x1 of row y, clipped to the world, to element, leaving bedrock alone. The
+  // span is woken in one go rather than a cell at a time. Shades are picked as by SetCell.
+  // Returns how many cells were written.
+  int FillSpan(int y, int x0, int x1, Cell::Element element);
+
+  // FNV-1a over every cell's state, for checking that two runs ended up in the same place.
+  [[nodiscard]] uint64_t HashCells() const;
+
+  // Counts every cell again and throws if GetPopulation or GetChunkPopulation disagree.
+  void VerifyPopulation() const;
+
+  // Always take the table driven path, even when the loaded elements match the built-in ones.
+  inline void SetGenericDispatch(const bool value) { genericDispatch = value; }
+  [[nodiscard]] inline bool GetGenericDispatch() const { return genericDispatch; }
+
+  void Update();
+
+private:
+  // Counts every cell's element, in total and per chunk, the way population is laid out.
+  void CountPopulation(std::array<int64_t, element_tables::kCount>& totals, std::vector<int>& perChunk) const;
+
+  // kBuiltin kernels know every element's type and weight at compile time; the others read them
+  // from the tables loaded by Cell::LoadElements.
+  template <bool kBuiltin>
+  [[nodiscard]] inline bool IsEmpty(const int pos) const {
+    if constexpr (kBuiltin) {
+      return Cell::IsBuiltinEmpty(cells.GetElement(pos));
+    } else {
+      return Cell::GetType(cells.GetElement(pos)) == Cell::Type::kEmpty;
+    }
+  }
+
+  template <bool kBuiltin>
+  void ApplyGravity(int pos, int weight, int direction, bool liquid);
+  // Returns whether the particle moved at all.
+  template <bool kBuiltin>
+  bool ApplySpread(int& pos, int spread, int direction);
+  // Drops the particle at pos and the run of the same element above it weight cells, if the way
+  // down is clear. Returns false, having done nothing, otherwise.
+  template <bool kBuiltin>
+  bool FallColumn(int pos, int weight);
+  // Follows the surface from pos in step's direction, stepping down a cell at a time, for up to
+  // flowReach cells. Returns where liquid at pos would end up: the edge of a deeper drop, or the
+  // bottom of a gentle slope. -1 if it can't get any lower that way.
+  template <bool kBuiltin>
+  [[nodiscard]] int FindDownhill(int pos, int step) const;
+
+  template <Cell::Element kElement>
+  void UpdateBuiltin(int pos, int direction);
+  template <size_t... kElements>
+  void DispatchBuiltin(int pos, Cell::Element element, int direction, std::index_sequence<kElements...>);
+  void UpdateGeneric(int pos, Cell::Element element, int direction);
+
+  template <bool kBuiltin>
+  void UpdateCell(int pos);
+  // Visits the cells from x0 to x1 of row y, which all lie in one chunk, skipping settled ones.
+  template <bool kBuiltin>
+  void UpdateRow(int y, int x0, int x1);
+  template <bool kBuiltin>
+  void UpdateSequential();
+  template <bool kBuiltin>
+  void UpdateCheckerboard();
+  template <bool kBuiltin>
+  void UpdateChunk(int index);
+
+  void DiffuseHeat();
+  // Works out the next heat of the heatChunks[task] chunk into its slot in heatScratch.
+  void DiffuseChunk(int task);
+  // Copies it back into the cells and notes whether the chunk is still hot.
+  void StoreHeat(int task);
+
+  Layout cells;
+  uint8_t generation = 1; // stamped on particles updated this tick, see cell_layout.h
+  bool genericDispatch = false;
+};
+
+// The layout the game is built with, picked by the SAND_SIM_CELL_LAYOUT CMake option.
+#if defined(SAND_SIM_CELL_LAYOUT_AOS)
+using AutomataMatrix = BasicAutomataMatrix<AosCellLayout>;
+#elif defined(SAND_SIM_CELL_LAYOUT_PACKED)
+using AutomataMatrix = BasicAutomataMatrix<PackedCellLayout>;
+#else
+using AutomataMatrix = BasicAutomataMatrix<SoaCellLayout>;
+#endif
+
+#endif //RAYLIB_SAND_SIM_SRC_AUTOMATA_MATRIX_H_
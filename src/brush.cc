@@ -0,0 +1,86 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "brush.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+Brush::Brush(const int radius, const Shape shape) {
+  this->shape = shape;
+  SetRadius(radius);
+}
+
+void Brush::SetRadius(const int radius) {
+  this->radius = std::clamp(radius, 0, kMaxRadius);
+  SetShape(shape);
+}
+
+void Brush::SetShape(const Shape shape) {
+  this->shape = shape;
+  halfWidths.resize(radius + 1);
+  for (int dy = 0; dy <= radius; dy++) {
+    if (shape == Shape::kSquare) {
+      halfWidths[dy] = radius;
+    } else {
+      // the extra half cell rounds the circle off instead of leaving a spike at each pole
+      const double reach = radius + 0.5;
+      halfWidths[dy] = static_cast<int>(std::sqrt(reach * reach - dy * dy));
+    }
+  }
+}
+
+void Brush::Rasterize(int x0, int y0, const int x1, const int y1, std::vector<Span>& spans) const {
+  const int top = std::min(y0, y1) - radius;
+  const int rows = std::abs(y1 - y0) + 2 * radius + 1;
+  spans.assign(rows, Span{0, INT_MAX, INT_MIN});
+
+  // Bresenham, stamping the shape's rows at every step
+  const int dx = std::abs(x1 - x0);
+  const int dy = -std::abs(y1 - y0);
+  const int stepX = x0 < x1 ? 1 : -1;
+  const int stepY = y0 < y1 ? 1 : -1;
+  int error = dx + dy;
+  while (true) {
+    for (int offset = -radius; offset <= radius; offset++) {
+      Span& span = spans[y0 + offset - top];
+      const int reach = halfWidths[std::abs(offset)];
+      span.x0 = std::min(span.x0, x0 - reach);
+      span.x1 = std::max(span.x1, x0 + reach);
+    }
+    if (x0 == x1 && y0 == y1) {
+      break;
+    }
+    const int doubled = 2 * error;
+    if (doubled >= dy) {
+      error += dy;
+      x0 += stepX;
+    }
+    if (doubled <= dx) {
+      error += dx;
+      y0 += stepY;
+    }
+  }
+
+  for (int row = 0; row < rows; row++) {
+    spans[row].y = top + row;
+  }
+}
+
+template <typename Layout>
+int Brush::Stroke(BasicAutomataMatrix<Layout>& world, const int x0, const int y0, const int x1, const int y1,
+                  const Cell::Element element) {
+  Rasterize(x0, y0, x1, y1, spans);
+  int written = 0;
+  for (const Span& span : spans) {
+    written += world.FillSpan(span.y, span.x0, span.x1, element);
+  }
+  return written;
+}
+
+template int Brush::Stroke(BasicAutomataMatrix<SoaCellLayout>&, int, int, int, int, Cell::Element);
+template int Brush::Stroke(BasicAutomataMatrix<AosCellLayout>&, int, int, int, int, Cell::Element);
+template int Brush::Stroke(BasicAutomataMatrix<PackedCellLayout>&, int, int, int, int, Cell::Element);
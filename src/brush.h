@@ -0,0 +1,57 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_BRUSH_H_
+#define RAYLIB_SAND_SIM_SRC_BRUSH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "automata_matrix.h"
+
+// Paints strokes: the brush shape swept along the line between two points, so a fast mouse
+// leaves no gaps. A stroke is turned into one span per row and written a span at a time, so it
+// costs time in proportion to the cells it covers.
+class Brush {
+ public:
+  enum class Shape : uint8_t {
+    kCircle,
+    kSquare,
+  };
+
+  static constexpr int kMaxRadius = 64;
+
+  // Cells x0 to x1 of row y, inclusive.
+  struct Span {
+    int y;
+    int x0;
+    int x1;
+  };
+
+  explicit Brush(int radius = 0, Shape shape = Shape::kCircle);
+
+  // 0 paints single cells; clamped to kMaxRadius.
+  void SetRadius(int radius);
+  [[nodiscard]] inline int GetRadius() const { return radius; }
+
+  void SetShape(Shape shape);
+  [[nodiscard]] inline Shape GetShape() const { return shape; }
+
+  // Replaces spans with the rows covered by the brush stamped at every point of the line from
+  // (x0, y0) to (x1, y1). The shape swept along a line is convex, so each row is a single span.
+  void Rasterize(int x0, int y0, int x1, int y1, std::vector<Span>& spans) const;
+
+  // Paints element along the stroke, clipped to the world and leaving bedrock alone. Returns how
+  // many cells were written.
+  template <typename Layout>
+  int Stroke(BasicAutomataMatrix<Layout>& world, int x0, int y0, int x1, int y1, Cell::Element element);
+
+ private:
+  int radius = 0;
+  Shape shape = Shape::kCircle;
+  std::vector<int> halfWidths; // per row offset from the centre, how far the shape reaches
+  std::vector<Span> spans;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_BRUSH_H_
@@ -0,0 +1,111 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "cell.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+#include "heat_kernel.h"
+
+std::array<Cell::Type,        static_cast<size_t>(Cell::Element::kCount)> Cell::types = Cell::kBuiltinTypes;
+std::array<int,               static_cast<size_t>(Cell::Element::kCount)> Cell::weights = Cell::kBuiltinWeights;
+std::array<int,               static_cast<size_t>(Cell::Element::kCount)> Cell::viscosity = element_tables::kViscosity;
+std::array<uint8_t,           static_cast<size_t>(Cell::Element::kCount)> Cell::conductivity = element_tables::kConductivity;
+std::array<std::string,       static_cast<size_t>(Cell::Element::kCount)> Cell::names = [] {
+  std::array<std::string, static_cast<size_t>(Cell::Element::kCount)> names;
+  for (size_t i = 0; i < names.size(); i++) {
+    names[i] = element_tables::kNames[i];
+  }
+  return names;
+}();
+std::array<Color,             static_cast<size_t>(Cell::Element::kCount)> Cell::colors = Cell::kBuiltinColors;
+std::array<Color,             Cell::kShadePaletteSize> Cell::shadePalette = Cell::BuildShadePalette(Cell::kBuiltinColors);
+bool Cell::builtinBehavior = true;
+
+namespace {
+
+// Brightness of each shade in 256ths of the element's color, spread around the color itself so
+// a mix of shades still reads as that color.
+constexpr std::array<int, Cell::kShadeCount> kShadeScales = {256, 236, 274, 220};
+
+// "#rrggbb" -> opaque color, or false if it isn't one.
+bool ParseColor(const std::string& text, Color& color) {
+  if (text.size() != 7 || text[0] != '#') {
+    return false;
+  }
+  uint8_t channels[3];
+  for (int i = 0; i < 3; i++) {
+    const std::string digits = text.substr(1 + 2 * i, 2);
+    if (!std::isxdigit(static_cast<unsigned char>(digits[0])) || !std::isxdigit(static_cast<unsigned char>(digits[1]))) {
+      return false;
+    }
+    channels[i] = static_cast<uint8_t>(std::stoi(digits, nullptr, 16));
+  }
+  color = Color{channels[0], channels[1], channels[2], 255};
+  return true;
+}
+
+} // namespace
+
+std::array<Color, Cell::kShadePaletteSize> Cell::BuildShadePalette(
+    const std::array<Color, element_tables::kCount>& colors) {
+  std::array<Color, kShadePaletteSize> palette{};
+  for (size_t element = 0; element < colors.size(); element++) {
+    const Color base = colors[element];
+    for (int shade = 0; shade < kShadeCount; shade++) {
+      const auto scale = [&](const uint8_t channel) {
+        return static_cast<uint8_t>(std::min(channel * kShadeScales[shade] / 256, 255));
+      };
+      palette[element * kShadeCount + shade] = Color{scale(base.r), scale(base.g), scale(base.b), base.a};
+    }
+  }
+  return palette;
+}
+
+void Cell::LoadElements(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  nlohmann::json json;
+  file >> json;
+
+  if (!json.contains("elements") || !json["elements"].is_array()) {
+    throw std::runtime_error("Invalid JSON config format: " + filename);
+  }
+  if (json["elements"].size() != static_cast<size_t>(Cell::Element::kCount)) {
+    throw std::runtime_error("JSON config must define the " + std::to_string(names.size()) +
+                             " compiled-in elements: " + filename);
+  }
+
+  for (const auto& element : json["elements"]) {
+    auto i = static_cast<size_t>(element["index"]);
+    if (i >= names.size() || element["name"].get<std::string>() != element_tables::kNames[i]) {
+      throw std::runtime_error("JSON config elements do not match the compiled-in ones: " + filename);
+    }
+    types[i] = static_cast<Cell::Type>(element["type"]);
+    weights[i] = element["weight"];
+    if (weights[i] < 0 || weights[i] > kMaxWeight) {
+      throw std::runtime_error("Element weight out of range in JSON config: " + filename);
+    }
+    viscosity[i] = element["viscosity"];
+    const int conducts = element["conductivity"];
+    if (conducts < 0 || conducts > HeatKernel::kMaxConductivity) {
+      throw std::runtime_error("Element conductivity out of range in JSON config: " + filename);
+    }
+    conductivity[i] = static_cast<uint8_t>(conducts);
+    if (!ParseColor(element["color"], colors[i])) {
+      throw std::runtime_error("Element color is not #rrggbb in JSON config: " + filename);
+    }
+    names[i] = element["name"];
+  }
+
+  shadePalette = BuildShadePalette(colors);
+  builtinBehavior = types == kBuiltinTypes && weights == kBuiltinWeights;
+}
@@ -0,0 +1,142 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_CELL_H_
+#define RAYLIB_SAND_SIM_SRC_CELL_H_
+
+#include <raylib.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+
+// generated from resources/elements.json at build time, see cmake/generate_elements.cmake
+#include "element_tables.h"
+
+class Cell {
+public:
+  using Element = element_tables::Element;
+
+  enum class Type : uint8_t {
+    kEmpty,
+    kPowder,
+    kSolid,
+    kLiquid,
+    kFire,
+    kGas,
+  };
+
+  // Upper bound on element weight; a particle never travels further than this in one tick.
+  static constexpr int kMaxWeight = 16;
+
+  // Each particle is drawn in one of this many variations of its element's color, picked when
+  // it is placed and carried with it as it moves, so a pile doesn't render as one flat color.
+  static constexpr int kShadeCount = 4;
+  static_assert((kShadeCount & (kShadeCount - 1)) == 0);
+
+  // The element set compiled into the update kernels. While the loaded definitions agree with it,
+  // cells are dispatched on these at compile time rather than through the tables below.
+  static constexpr std::array<Type, element_tables::kCount> kBuiltinTypes = [] {
+    std::array<Type, element_tables::kCount> types{};
+    for (size_t i = 0; i < types.size(); i++) {
+      types[i] = static_cast<Type>(element_tables::kTypes[i]);
+    }
+    return types;
+  }();
+  static constexpr std::array<int, element_tables::kCount> kBuiltinWeights = element_tables::kWeights;
+  static constexpr std::array<Color, element_tables::kCount> kBuiltinColors = [] {
+    std::array<Color, element_tables::kCount> colors{};
+    for (size_t i = 0; i < colors.size(); i++) {
+      const auto& [r, g, b, a] = element_tables::kColors[i];
+      colors[i] = Color{r, g, b, a};
+    }
+    return colors;
+  }();
+
+  static_assert(std::ranges::all_of(kBuiltinWeights, [](int weight) { return weight >= 0 && weight <= kMaxWeight; }),
+                "element weight out of range in resources/elements.json");
+
+  static constexpr Type GetBuiltinType(Element element) {
+    return kBuiltinTypes[static_cast<size_t>(element)];
+  }
+
+  static constexpr int GetBuiltinWeight(Element element) {
+    return kBuiltinWeights[static_cast<size_t>(element)];
+  }
+
+  // Built-in elements a particle can move into, one bit per element.
+  static constexpr uint32_t kBuiltinEmptyMask = [] {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kBuiltinTypes.size(); i++) {
+      mask |= kBuiltinTypes[i] == Type::kEmpty ? 1u << i : 0u;
+    }
+    return mask;
+  }();
+  static_assert(static_cast<size_t>(Element::kCount) <= 32);
+
+  static constexpr bool IsBuiltinEmpty(Element element) {
+    return (kBuiltinEmptyMask >> static_cast<uint32_t>(element)) & 1u;
+  }
+
+  // True when the loaded types and weights match the built-in ones.
+  static bool HasBuiltinBehavior() {
+    return builtinBehavior;
+  }
+
+  // Replaces the compiled-in properties with the ones in a JSON file, for experimenting without
+  // a rebuild. The file must describe the same elements in the same order.
+  static void LoadElements(const std::string& filename);
+
+  static Type GetType(Element element) {
+    return types[static_cast<size_t>(element)];
+  }
+
+  static Color GetColor(Element element) {
+    return colors[static_cast<size_t>(element)];
+  }
+
+  // Every element's shade variations, kShadeCount per element: the color of shade s of element e
+  // is at e * kShadeCount + s. Rebuilt whenever the colors are loaded.
+  static const Color* GetShadePalette() {
+    return shadePalette.data();
+  }
+
+  static constexpr int kShadePaletteSize = element_tables::kCount * kShadeCount;
+
+  static int GetWeight(Element element) {
+    return weights[static_cast<size_t>(element)];
+  }
+
+  static int GetViscosity(Element element) {
+    return viscosity[static_cast<size_t>(element)];
+  }
+
+  // How readily heat passes through the element, see HeatKernel.
+  static uint8_t GetConductivity(Element element) {
+    return conductivity[static_cast<size_t>(element)];
+  }
+
+  // Every element's conductivity, indexed by element.
+  static const uint8_t* GetConductivityTable() {
+    return conductivity.data();
+  }
+
+  static std::string GetName(Element element) {
+    return names[static_cast<size_t>(element)];
+  }
+
+private:
+  static std::array<Type,        static_cast<size_t>(Element::kCount)> types;
+  static std::array<int,         static_cast<size_t>(Element::kCount)> weights;
+  static std::array<int,         static_cast<size_t>(Element::kCount)> viscosity;
+  static std::array<uint8_t,     static_cast<size_t>(Element::kCount)> conductivity;
+  static std::array<std::string, static_cast<size_t>(Element::kCount)> names;
+  static std::array<Color,       static_cast<size_t>(Element::kCount)> colors;
+  static std::array<Color,       kShadePaletteSize> shadePalette;
+  static bool builtinBehavior;
+
+  static std::array<Color, kShadePaletteSize> BuildShadePalette(const std::array<Color, element_tables::kCount>& colors);
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_CELL_H_
@@ -0,0 +1,226 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_CELL_LAYOUT_H_
+#define RAYLIB_SAND_SIM_SRC_CELL_LAYOUT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "cell.h"
+
+static_assert(static_cast<int>(Cell::Element::kAir) == 0, "zeroed cells must be air");
+
+// Storage layouts for the per-cell state of an AutomataMatrix. They all expose the same
+// accessors, so the update kernels are written once and compiled against each of them.
+// Swap moves a whole cell, particle data included.
+//
+// Each cell also carries an update generation. A particle is stamped with the tick's generation
+// (1 to kGenerations) when it is updated, so a cell holding the current one has already been
+// updated this tick. Nothing has generation 0, and ClearUpdated resets every cell to it once all
+// the generations have been handed out, so there is one clearing pass per kGenerations ticks
+// instead of one per tick. kUpdatedStride is how many bytes that pass streams through per cell.
+//
+// A freshly constructed layout is all air at generation 0. CopyTo and CopyFrom move the raw
+// state of every cell, kBytesPerCell each, to and from an outside buffer.
+
+// Structure of arrays: one array per field.
+class SoaCellLayout {
+ public:
+  static constexpr const char* kName = "soa";
+  static constexpr uint8_t kGenerations = 255;
+  static constexpr int kUpdatedStride = sizeof(uint8_t);
+  static constexpr int kBytesPerCell = 4;
+
+  explicit SoaCellLayout(const int size) : element(size), heat(size), shade(size), updated(size) {}
+
+  [[nodiscard]] inline Cell::Element GetElement(const int pos) const { return element[pos]; }
+  inline void SetElement(const int pos, const Cell::Element value) { element[pos] = value; }
+
+  [[nodiscard]] inline uint8_t GetHeat(const int pos) const { return heat[pos]; }
+  inline void SetHeat(const int pos, const uint8_t value) { heat[pos] = value; }
+
+  [[nodiscard]] inline uint8_t GetShade(const int pos) const { return shade[pos]; }
+  inline void SetShade(const int pos, const uint8_t value) { shade[pos] = value; }
+
+  [[nodiscard]] inline uint8_t GetUpdated(const int pos) const { return updated[pos]; }
+  inline void SetUpdated(const int pos, const uint8_t generation) { updated[pos] = generation; }
+  inline void ClearUpdated() { std::fill(updated.begin(), updated.end(), 0); }
+
+  inline void Swap(const int pos1, const int pos2) {
+    std::swap(element[pos1], element[pos2]);
+    std::swap(heat[pos1], heat[pos2]);
+    std::swap(shade[pos1], shade[pos2]);
+    std::swap(updated[pos1], updated[pos2]);
+  }
+
+  // Elements of count cells starting at pos, gathered into scratch when they are not contiguous.
+  [[nodiscard]] inline const Cell::Element* ReadElements(const int pos, int, Cell::Element*) const {
+    return &element[pos];
+  }
+
+  // Likewise for shades.
+  [[nodiscard]] inline const uint8_t* ReadShades(const int pos, int, uint8_t*) const {
+    return &shade[pos];
+  }
+
+  inline void CopyTo(uint8_t* out) const {
+    const size_t size = element.size();
+    std::memcpy(out, element.data(), size);
+    std::memcpy(out + size, heat.data(), size);
+    std::memcpy(out + 2 * size, shade.data(), size);
+    std::memcpy(out + 3 * size, updated.data(), size);
+  }
+
+  inline void CopyFrom(const uint8_t* in) {
+    const size_t size = element.size();
+    std::memcpy(element.data(), in, size);
+    std::memcpy(heat.data(), in + size, size);
+    std::memcpy(shade.data(), in + 2 * size, size);
+    std::memcpy(updated.data(), in + 3 * size, size);
+  }
+
+ private:
+  std::vector<Cell::Element> element;
+  std::vector<uint8_t>       heat;
+  std::vector<uint8_t>       shade;
+  std::vector<uint8_t>       updated;
+};
+
+// Array of structures: every field of a cell in one four byte record.
+class AosCellLayout {
+ public:
+  static constexpr const char* kName = "aos";
+  static constexpr uint8_t kGenerations = 255;
+  static constexpr int kUpdatedStride = 4;
+  static constexpr int kBytesPerCell = 4;
+
+  explicit AosCellLayout(const int size) : cells(size) {}
+
+  [[nodiscard]] inline Cell::Element GetElement(const int pos) const { return cells[pos].element; }
+  inline void SetElement(const int pos, const Cell::Element value) { cells[pos].element = value; }
+
+  [[nodiscard]] inline uint8_t GetHeat(const int pos) const { return cells[pos].heat; }
+  inline void SetHeat(const int pos, const uint8_t value) { cells[pos].heat = value; }
+
+  [[nodiscard]] inline uint8_t GetShade(const int pos) const { return cells[pos].shade; }
+  inline void SetShade(const int pos, const uint8_t value) { cells[pos].shade = value; }
+
+  [[nodiscard]] inline uint8_t GetUpdated(const int pos) const { return cells[pos].updated; }
+  inline void SetUpdated(const int pos, const uint8_t generation) { cells[pos].updated = generation; }
+  inline void ClearUpdated() {
+    for (Record& record : cells) {
+      record.updated = 0;
+    }
+  }
+
+  inline void Swap(const int pos1, const int pos2) { std::swap(cells[pos1], cells[pos2]); }
+
+  [[nodiscard]] inline const Cell::Element* ReadElements(const int pos, const int count, Cell::Element* scratch) const {
+    for (int i = 0; i < count; i++) {
+      scratch[i] = cells[pos + i].element;
+    }
+    return scratch;
+  }
+
+  [[nodiscard]] inline const uint8_t* ReadShades(const int pos, const int count, uint8_t* scratch) const {
+    for (int i = 0; i < count; i++) {
+      scratch[i] = cells[pos + i].shade;
+    }
+    return scratch;
+  }
+
+  inline void CopyTo(uint8_t* out) const { std::memcpy(out, cells.data(), cells.size() * sizeof(Record)); }
+  inline void CopyFrom(const uint8_t* in) { std::memcpy(cells.data(), in, cells.size() * sizeof(Record)); }
+
+ private:
+  struct Record {
+    Cell::Element element;
+    uint8_t heat;
+    uint8_t shade;
+    uint8_t updated;
+  };
+  static_assert(sizeof(Record) == AosCellLayout::kUpdatedStride);
+
+  std::vector<Record> cells;
+};
+
+// Every field of a cell squeezed into one 16-bit word:
+//   bits 0-3 element, 4-5 shade, 6-7 update generation, 8-15 heat
+// Half the memory of the other layouts, paid for with shifts and masks, at most 16 elements and
+// 4 shades, and only 3 generations between clearing passes.
+class PackedCellLayout {
+ public:
+  static constexpr const char* kName = "packed";
+  static constexpr uint8_t kGenerations = 3;
+  static constexpr int kUpdatedStride = sizeof(uint16_t);
+  static constexpr int kBytesPerCell = sizeof(uint16_t);
+
+  static_assert(static_cast<int>(Cell::Element::kCount) <= 16);
+  static_assert(Cell::kShadeCount <= 4);
+
+  explicit PackedCellLayout(const int size) : cells(size) {}
+
+  [[nodiscard]] inline Cell::Element GetElement(const int pos) const {
+    return static_cast<Cell::Element>(cells[pos] & kElementMask);
+  }
+  inline void SetElement(const int pos, const Cell::Element value) {
+    cells[pos] = (cells[pos] & ~kElementMask) | static_cast<uint16_t>(value);
+  }
+
+  [[nodiscard]] inline uint8_t GetHeat(const int pos) const { return cells[pos] >> kHeatShift; }
+  inline void SetHeat(const int pos, const uint8_t value) {
+    cells[pos] = (cells[pos] & ~kHeatMask) | static_cast<uint16_t>(value << kHeatShift);
+  }
+
+  [[nodiscard]] inline uint8_t GetShade(const int pos) const { return (cells[pos] & kShadeMask) >> kShadeShift; }
+  inline void SetShade(const int pos, const uint8_t value) {
+    cells[pos] = (cells[pos] & ~kShadeMask) | static_cast<uint16_t>((value << kShadeShift) & kShadeMask);
+  }
+
+  [[nodiscard]] inline uint8_t GetUpdated(const int pos) const { return (cells[pos] & kUpdatedMask) >> kUpdatedShift; }
+  inline void SetUpdated(const int pos, const uint8_t generation) {
+    cells[pos] = (cells[pos] & ~kUpdatedMask) | static_cast<uint16_t>(generation << kUpdatedShift);
+  }
+  inline void ClearUpdated() {
+    for (uint16_t& word : cells) {
+      word &= ~kUpdatedMask;
+    }
+  }
+
+  inline void Swap(const int pos1, const int pos2) { std::swap(cells[pos1], cells[pos2]); }
+
+  [[nodiscard]] inline const Cell::Element* ReadElements(const int pos, const int count, Cell::Element* scratch) const {
+    for (int i = 0; i < count; i++) {
+      scratch[i] = static_cast<Cell::Element>(cells[pos + i] & kElementMask);
+    }
+    return scratch;
+  }
+
+  [[nodiscard]] inline const uint8_t* ReadShades(const int pos, const int count, uint8_t* scratch) const {
+    for (int i = 0; i < count; i++) {
+      scratch[i] = static_cast<uint8_t>((cells[pos + i] & kShadeMask) >> kShadeShift);
+    }
+    return scratch;
+  }
+
+  inline void CopyTo(uint8_t* out) const { std::memcpy(out, cells.data(), cells.size() * sizeof(uint16_t)); }
+  inline void CopyFrom(const uint8_t* in) { std::memcpy(cells.data(), in, cells.size() * sizeof(uint16_t)); }
+
+ private:
+  static constexpr uint16_t kElementMask = 0x000f;
+  static constexpr int      kShadeShift  = 4;
+  static constexpr uint16_t kShadeMask   = 0x0030;
+  static constexpr int      kUpdatedShift = 6;
+  static constexpr uint16_t kUpdatedMask = 0x00c0;
+  static constexpr int      kHeatShift   = 8;
+  static constexpr uint16_t kHeatMask    = 0xff00;
+
+  std::vector<uint16_t> cells;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_CELL_LAYOUT_H_
@@ -0,0 +1,90 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "chunk_store.h"
+
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SAND_SIM_HAVE_MMAP
+#endif
+
+#ifdef SAND_SIM_HAVE_MMAP
+
+ChunkStore::ChunkStore(const std::string& filename, const size_t slotBytes) : filename(filename) {
+  // whole pages per slot, so evicting one never touches its neighbours
+  const auto pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  this->slotBytes = (slotBytes + pageBytes - 1) / pageBytes * pageBytes;
+
+  fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+}
+
+ChunkStore::~ChunkStore() {
+  if (mapping) {
+    munmap(mapping, GetFileBytes());
+  }
+  close(fd);
+  unlink(filename.c_str());
+}
+
+int ChunkStore::Allocate() {
+  if (!freeSlots.empty()) {
+    const int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+  if (used == capacity) {
+    Grow();
+  }
+  return static_cast<int>(used++);
+}
+
+void ChunkStore::Release(const int slot) {
+  freeSlots.push_back(slot);
+}
+
+void ChunkStore::Evict(const int slot) {
+  uint8_t* data = GetSlot(slot);
+  msync(data, slotBytes, MS_ASYNC);
+  madvise(data, slotBytes, MADV_DONTNEED);
+}
+
+void ChunkStore::Grow() {
+  const size_t newCapacity = capacity ? capacity * 2 : 64;
+  if (ftruncate(fd, static_cast<off_t>(newCapacity * slotBytes)) != 0) {
+    throw std::runtime_error("Failed to grow chunk store: " + filename);
+  }
+  // the old mapping goes only once the new one exists, so a failure leaves the store as it was
+  // (apart from a longer file, which is harmless)
+  void* address = mmap(nullptr, newCapacity * slotBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("Failed to map chunk store: " + filename);
+  }
+  if (mapping) {
+    munmap(mapping, GetFileBytes());
+  }
+  mapping = static_cast<uint8_t*>(address);
+  capacity = newCapacity;
+}
+
+#else
+
+ChunkStore::ChunkStore(const std::string& filename, const size_t slotBytes)
+    : filename(filename), slotBytes(slotBytes) {
+  throw std::runtime_error("Chunk paging needs memory-mapped files, which this platform lacks");
+}
+
+ChunkStore::~ChunkStore() = default;
+int ChunkStore::Allocate() { return -1; }
+void ChunkStore::Release(int) {}
+void ChunkStore::Evict(int) {}
+void ChunkStore::Grow() {}
+
+#endif
@@ -0,0 +1,52 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_CHUNK_STORE_H_
+#define RAYLIB_SAND_SIM_SRC_CHUNK_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fixed size slots in a memory-mapped file, where a world parks the chunks it is not using.
+// Evicting a slot drops its pages from memory but keeps its contents in the file, to be faulted
+// back in the next time it is read. The file grows as slots are handed out and is deleted with
+// the store. Needs POSIX mmap; elsewhere the constructor throws.
+class ChunkStore {
+ public:
+  ChunkStore(const std::string& filename, size_t slotBytes);
+  ~ChunkStore();
+
+  ChunkStore(const ChunkStore&) = delete;
+  ChunkStore& operator=(const ChunkStore&) = delete;
+
+  // Hands out a slot of at least the requested size. Pointers from GetSlot are invalidated.
+  int Allocate();
+  void Release(int slot);
+
+  [[nodiscard]] inline uint8_t* GetSlot(const int slot) { return mapping + static_cast<size_t>(slot) * slotBytes; }
+  [[nodiscard]] inline const uint8_t* GetSlot(const int slot) const {
+    return mapping + static_cast<size_t>(slot) * slotBytes;
+  }
+
+  // Starts writing the slot back to the file and lets go of its pages.
+  void Evict(int slot);
+
+  [[nodiscard]] inline size_t GetSlotBytes() const { return slotBytes; }
+  [[nodiscard]] inline size_t GetFileBytes() const { return capacity * slotBytes; }
+
+ private:
+  void Grow();
+
+  std::string filename;
+  int fd = -1;
+  uint8_t* mapping = nullptr;
+  size_t slotBytes;
+  size_t capacity = 0;  // slots the file holds
+  size_t used = 0;      // slots ever handed out
+  std::vector<int> freeSlots;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_CHUNK_STORE_H_
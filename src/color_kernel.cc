@@ -0,0 +1,183 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "color_kernel.h"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SAND_SIM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+ColorKernel::ColorKernel(const Color* colors, const int paletteSize, const Isa requested) {
+  std::copy_n(colors, std::min(paletteSize, 256), palette.begin());
+  for (int i = 0; i < std::min(paletteSize, kMaxVectorPaletteSize); i++) {
+    planes[0][i] = colors[i].r;
+    planes[1][i] = colors[i].g;
+    planes[2][i] = colors[i].b;
+    planes[3][i] = colors[i].a;
+  }
+  shuffles = std::max((std::min(paletteSize, kMaxVectorPaletteSize) + kShuffleSize - 1) / kShuffleSize, 1);
+
+  isa = std::min(requested, DetectIsa());
+  if (paletteSize > kMaxVectorPaletteSize) {
+    isa = Isa::kScalar;
+  }
+  switch (isa) {
+    case Isa::kAvx2:
+      convertRow = ConvertRowAvx2;
+      break;
+    case Isa::kSsse3:
+      convertRow = ConvertRowSsse3;
+      break;
+    default:
+      convertRow = ConvertRowScalar;
+      break;
+  }
+}
+
+ColorKernel::Isa ColorKernel::DetectIsa() {
+#ifdef SAND_SIM_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::kAvx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return Isa::kSsse3;
+  }
+#endif
+  return Isa::kScalar;
+}
+
+const char* ColorKernel::GetIsaName(const Isa isa) {
+  switch (isa) {
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kSsse3:
+      return "ssse3";
+    default:
+      return "scalar";
+  }
+}
+
+void ColorKernel::ConvertRowScalar(const ColorKernel& kernel, const uint8_t* ids, Color* out, const int count) {
+  for (int i = 0; i < count; i++) {
+    out[i] = kernel.palette[ids[i]];
+  }
+}
+
+#ifdef SAND_SIM_X86_KERNELS
+
+namespace {
+
+// Adding this to an id xored with the first id of a 16 entry block leaves bit 7 clear only for
+// ids in that block (with their offset into it in the low bits). A shuffle turns every lane with
+// bit 7 set into 0, so or-ing one shuffle per block together looks up the whole palette.
+constexpr char kOutsideBlock = 0x70;
+
+__attribute__((target("ssse3")))
+inline __m128i LoadBlock(const uint8_t* block) {
+  return _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+}
+
+// vpshufb looks up within each 128-bit lane, so both lanes get a copy of the block
+__attribute__((target("avx2")))
+inline __m256i LoadBlock2x(const uint8_t* block) {
+  return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(block)));
+}
+
+} // namespace
+
+__attribute__((target("ssse3")))
+void ColorKernel::ConvertRowSsse3(const ColorKernel& kernel, const uint8_t* ids, Color* out, const int count) {
+  const auto plane = [&kernel](const int channel, const int block) {
+    return &kernel.planes[channel][block * kShuffleSize];
+  };
+  const __m128i outside = _mm_set1_epi8(kOutsideBlock);
+
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ids + i));
+    __m128i red = _mm_setzero_si128();
+    __m128i green = _mm_setzero_si128();
+    __m128i blue = _mm_setzero_si128();
+    __m128i alpha = _mm_setzero_si128();
+    for (int block = 0; block < kernel.shuffles; block++) {
+      const __m128i local = _mm_adds_epu8(_mm_xor_si128(index, _mm_set1_epi8(static_cast<char>(block * kShuffleSize))),
+                                          outside);
+      red = _mm_or_si128(red, _mm_shuffle_epi8(LoadBlock(plane(0, block)), local));
+      green = _mm_or_si128(green, _mm_shuffle_epi8(LoadBlock(plane(1, block)), local));
+      blue = _mm_or_si128(blue, _mm_shuffle_epi8(LoadBlock(plane(2, block)), local));
+      alpha = _mm_or_si128(alpha, _mm_shuffle_epi8(LoadBlock(plane(3, block)), local));
+    }
+
+    // interleave the planes back into rgba pixels
+    const __m128i rgLo = _mm_unpacklo_epi8(red, green);
+    const __m128i rgHi = _mm_unpackhi_epi8(red, green);
+    const __m128i baLo = _mm_unpacklo_epi8(blue, alpha);
+    const __m128i baHi = _mm_unpackhi_epi8(blue, alpha);
+
+    auto* dst = reinterpret_cast<__m128i*>(out + i);
+    _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(rgHi, baHi));
+  }
+  ConvertRowScalar(kernel, ids + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void ColorKernel::ConvertRowAvx2(const ColorKernel& kernel, const uint8_t* ids, Color* out, const int count) {
+  const auto plane = [&kernel](const int channel, const int block) {
+    return &kernel.planes[channel][block * kShuffleSize];
+  };
+  const __m256i outside = _mm256_set1_epi8(kOutsideBlock);
+
+  int i = 0;
+  for (; i + 32 <= count; i += 32) {
+    const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+    __m256i red = _mm256_setzero_si256();
+    __m256i green = _mm256_setzero_si256();
+    __m256i blue = _mm256_setzero_si256();
+    __m256i alpha = _mm256_setzero_si256();
+    for (int block = 0; block < kernel.shuffles; block++) {
+      const __m256i local = _mm256_adds_epu8(
+          _mm256_xor_si256(index, _mm256_set1_epi8(static_cast<char>(block * kShuffleSize))), outside);
+      red = _mm256_or_si256(red, _mm256_shuffle_epi8(LoadBlock2x(plane(0, block)), local));
+      green = _mm256_or_si256(green, _mm256_shuffle_epi8(LoadBlock2x(plane(1, block)), local));
+      blue = _mm256_or_si256(blue, _mm256_shuffle_epi8(LoadBlock2x(plane(2, block)), local));
+      alpha = _mm256_or_si256(alpha, _mm256_shuffle_epi8(LoadBlock2x(plane(3, block)), local));
+    }
+
+    // unpacks stay inside their lane: lane 0 holds pixels 0-15, lane 1 pixels 16-31
+    const __m256i rgLo = _mm256_unpacklo_epi8(red, green);
+    const __m256i rgHi = _mm256_unpackhi_epi8(red, green);
+    const __m256i baLo = _mm256_unpacklo_epi8(blue, alpha);
+    const __m256i baHi = _mm256_unpackhi_epi8(blue, alpha);
+    const __m256i pixels0 = _mm256_unpacklo_epi16(rgLo, baLo); // 0-3   | 16-19
+    const __m256i pixels1 = _mm256_unpackhi_epi16(rgLo, baLo); // 4-7   | 20-23
+    const __m256i pixels2 = _mm256_unpacklo_epi16(rgHi, baHi); // 8-11  | 24-27
+    const __m256i pixels3 = _mm256_unpackhi_epi16(rgHi, baHi); // 12-15 | 28-31
+
+    auto* dst = reinterpret_cast<__m256i*>(out + i);
+    _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+    _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+    _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+  }
+  ConvertRowSsse3(kernel, ids + i, out + i, count - i);
+}
+
+#else
+
+void ColorKernel::ConvertRowSsse3(const ColorKernel& kernel, const uint8_t* ids, Color* out, const int count) {
+  ConvertRowScalar(kernel, ids, out, count);
+}
+
+void ColorKernel::ConvertRowAvx2(const ColorKernel& kernel, const uint8_t* ids, Color* out, const int count) {
+  ConvertRowScalar(kernel, ids, out, count);
+}
+
+#endif
@@ -0,0 +1,57 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_COLOR_KERNEL_H_
+#define RAYLIB_SAND_SIM_SRC_COLOR_KERNEL_H_
+
+#include <raylib.h>
+#include <array>
+#include <cstdint>
+
+// Turns rows of one-byte palette ids into RGBA8 pixels through a small palette. On x86 the
+// palette is split into four byte planes and looked up 16 or 32 ids at a time with byte
+// shuffles, one per 16 entries of the palette; everything else, and palettes too big for a few
+// shuffles, use the scalar loop.
+class ColorKernel {
+ public:
+  enum class Isa {
+    kScalar,
+    kSsse3,
+    kAvx2,
+  };
+
+  // A shuffle can only index 16 bytes, so bigger palettes take one per 16 entries.
+  static constexpr int kShuffleSize = 16;
+  static constexpr int kMaxVectorPaletteSize = 4 * kShuffleSize;
+
+  // Uses the best instruction set the CPU supports, or at most the one asked for.
+  explicit ColorKernel(const Color* palette, int paletteSize, Isa isa = DetectIsa());
+
+  // ids must all be below the palette size.
+  inline void ConvertRow(const uint8_t* ids, Color* out, int count) const {
+    convertRow(*this, ids, out, count);
+  }
+
+  [[nodiscard]] inline Isa GetIsa() const { return isa; }
+
+  static Isa DetectIsa();
+  static const char* GetIsaName(Isa isa);
+
+ private:
+  using ConvertRowFn = void (*)(const ColorKernel& kernel, const uint8_t* ids, Color* out, int count);
+
+  static void ConvertRowScalar(const ColorKernel& kernel, const uint8_t* ids, Color* out, int count);
+  static void ConvertRowSsse3(const ColorKernel& kernel, const uint8_t* ids, Color* out, int count);
+  static void ConvertRowAvx2(const ColorKernel& kernel, const uint8_t* ids, Color* out, int count);
+
+  std::array<Color, 256> palette = {};
+  // palette split into r, g, b and a bytes, the layout the shuffles want
+  alignas(16) std::array<std::array<uint8_t, kMaxVectorPaletteSize>, 4> planes = {};
+  int shuffles = 1; // 16 entry blocks of planes in use
+
+  Isa isa;
+  ConvertRowFn convertRow;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_COLOR_KERNEL_H_
@@ -0,0 +1,47 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "fixed_step_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+FixedStepScheduler::FixedStepScheduler(const double stepSeconds, const int maxSteps)
+    : stepSeconds(stepSeconds), maxSteps(maxSteps) {
+  if (!(stepSeconds > 0.0)) {
+    throw std::runtime_error("Fixed step length must be positive");
+  }
+  SetMaxSteps(maxSteps);
+}
+
+int FixedStepScheduler::Advance(const double elapsedSeconds) {
+  // a clock that went backwards counts as no time at all
+  lag += std::max(elapsedSeconds, 0.0);
+  const double due = std::floor(lag / stepSeconds);
+  if (due <= maxSteps) {
+    lag -= due * stepSeconds;
+    return static_cast<int>(due);
+  }
+
+  // too far behind: run the cap and drop the rest, keeping the fraction of a step left over
+  droppedSteps += static_cast<uint64_t>(due) - maxSteps;
+  lag -= due * stepSeconds;
+  return maxSteps;
+}
+
+void FixedStepScheduler::Reset() {
+  lag = 0.0;
+}
+
+double FixedStepScheduler::GetAlpha() const {
+  return std::clamp(lag / stepSeconds, 0.0, 1.0);
+}
+
+void FixedStepScheduler::SetMaxSteps(const int maxSteps) {
+  if (maxSteps < 1) {
+    throw std::runtime_error("A frame must be allowed at least one step");
+  }
+  this->maxSteps = maxSteps;
+}
@@ -0,0 +1,42 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_FIXED_STEP_SCHEDULER_H_
+#define RAYLIB_SAND_SIM_SRC_FIXED_STEP_SCHEDULER_H_
+
+#include <cstdint>
+
+// Turns the wall-clock time between frames into whole simulation steps of a fixed length. Time
+// left over carries into the next frame, so the simulation keeps pace with the clock however the
+// frame rate varies. A frame never runs more than the step cap; time beyond that is dropped, so a
+// machine that can't keep up runs the simulation slower instead of falling further and further
+// behind.
+class FixedStepScheduler {
+ public:
+  FixedStepScheduler(double stepSeconds, int maxSteps);
+
+  // Adds a frame's elapsed time and returns how many steps to run for it, at most the cap.
+  int Advance(double elapsedSeconds);
+
+  // Forgets the time built up so far, e.g. after the simulation was paused.
+  void Reset();
+
+  // How far the clock is into the next step, 0 to 1, for drawing between two steps.
+  [[nodiscard]] double GetAlpha() const;
+
+  [[nodiscard]] inline double GetStepSeconds() const { return stepSeconds; }
+  [[nodiscard]] inline int GetMaxSteps() const { return maxSteps; }
+  void SetMaxSteps(int maxSteps);
+
+  // Steps dropped so far because a frame needed more than the cap.
+  [[nodiscard]] inline uint64_t GetDroppedSteps() const { return droppedSteps; }
+
+ private:
+  double stepSeconds;
+  int maxSteps;
+  double lag = 0.0;
+  uint64_t droppedSteps = 0;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_FIXED_STEP_SCHEDULER_H_
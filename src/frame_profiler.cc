@@ -0,0 +1,126 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "frame_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+FrameProfiler::FrameProfiler() {
+  for (std::vector<double>& samples : history) {
+    samples.reserve(kWindow);
+  }
+}
+
+void FrameProfiler::SetEnabled(const bool enabled) {
+  if (enabled == this->enabled) {
+    return;
+  }
+  this->enabled = enabled;
+  Reset();
+}
+
+void FrameProfiler::OpenLog(const std::string& filename) {
+  log.open(filename);
+  if (!log.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+  log << "frame";
+  for (size_t i = 0; i < kPhaseCount; i++) {
+    log << ',' << GetPhaseName(static_cast<Phase>(i)) << "_ms";
+  }
+  log << '\n' << std::fixed << std::setprecision(4);
+  SetEnabled(true);
+}
+
+void FrameProfiler::EndFrame() {
+  if (!enabled) {
+    return;
+  }
+  const Clock::time_point now = Clock::now();
+  Add(Phase::kFrame, now - frameStart);
+  frameStart = now;
+
+  for (size_t i = 0; i < kPhaseCount; i++) {
+    if (!ran[i]) {
+      continue;
+    }
+    std::vector<double>& samples = history[i];
+    if (samples.size() < kWindow) {
+      samples.push_back(current[i]);
+    } else {
+      samples[historyNext[i]] = current[i];
+    }
+    historyNext[i] = (historyNext[i] + 1) % kWindow;
+  }
+
+  // phases that didn't run this frame are left blank rather than logged as 0
+  if (log.is_open()) {
+    log << frameCount;
+    for (size_t i = 0; i < kPhaseCount; i++) {
+      log << ',';
+      if (ran[i]) {
+        log << current[i];
+      }
+    }
+    log << '\n';
+  }
+
+  frameCount++;
+  current.fill(0.0);
+  ran.fill(false);
+}
+
+FrameProfiler::Stats FrameProfiler::GetStats(const Phase phase) const {
+  const std::vector<double>& samples = history[static_cast<size_t>(phase)];
+  if (samples.empty()) {
+    return {};
+  }
+
+  Stats stats;
+  stats.samples = static_cast<int>(samples.size());
+  stats.minMs = *std::ranges::min_element(samples);
+  double total = 0.0;
+  for (const double sample : samples) {
+    total += sample;
+  }
+  stats.avgMs = total / samples.size();
+
+  std::vector<double> sorted = samples;
+  const size_t rank = (sorted.size() * 99) / 100;
+  std::ranges::nth_element(sorted, sorted.begin() + rank);
+  stats.p99Ms = sorted[rank];
+  return stats;
+}
+
+const char* FrameProfiler::GetPhaseName(const Phase phase) {
+  switch (phase) {
+    case Phase::kInput:
+      return "input";
+    case Phase::kSimulation:
+      return "simulation";
+    case Phase::kConvert:
+      return "convert";
+    case Phase::kUpload:
+      return "upload";
+    case Phase::kDraw:
+      return "draw";
+    case Phase::kFrame:
+      return "frame";
+    case Phase::kCount:
+      break;
+  }
+  return "unknown";
+}
+
+void FrameProfiler::Reset() {
+  current.fill(0.0);
+  ran.fill(false);
+  for (size_t i = 0; i < kPhaseCount; i++) {
+    history[i].clear();
+    historyNext[i] = 0;
+  }
+  frameStart = Clock::now();
+}
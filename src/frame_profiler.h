@@ -0,0 +1,112 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_FRAME_PROFILER_H_
+#define RAYLIB_SAND_SIM_SRC_FRAME_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Times the phases of each frame and keeps rolling min, average and 99th percentile figures for
+// them, optionally writing every frame to a CSV file. While disabled a timer costs a branch.
+class FrameProfiler {
+ public:
+  enum class Phase {
+    kInput,
+    kSimulation,
+    kConvert, // element ids to pixels
+    kUpload,  // pixels to the GPU texture
+    kDraw,
+    kFrame,   // the whole frame, including waiting for vsync
+    kCount,
+  };
+
+  // Frames the rolling figures cover.
+  static constexpr int kWindow = 240;
+
+  struct Stats {
+    double minMs = 0.0;
+    double avgMs = 0.0;
+    double p99Ms = 0.0;
+    int samples = 0; // frames in the window the phase ran in
+  };
+
+  // Adds the time until it goes out of scope to a phase of the current frame. Does nothing when
+  // the profiler is null or disabled.
+  class Scope {
+   public:
+    inline Scope(FrameProfiler* profiler, const Phase phase)
+        : profiler(profiler != nullptr && profiler->enabled ? profiler : nullptr), phase(phase) {
+      if (this->profiler != nullptr) {
+        start = Clock::now();
+      }
+    }
+
+    inline ~Scope() {
+      if (profiler != nullptr) {
+        profiler->Add(phase, Clock::now() - start);
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    FrameProfiler* profiler;
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  FrameProfiler();
+
+  // Turning the profiler off drops the rolling figures, so they never mix old and new frames.
+  void SetEnabled(bool enabled);
+  [[nodiscard]] inline bool IsEnabled() const { return enabled; }
+
+  // Writes a header and then one row per frame to filename, and enables the profiler.
+  void OpenLog(const std::string& filename);
+
+  // Adds time measured elsewhere, e.g. on another thread, to a phase of the current frame.
+  inline void AddTime(const Phase phase, const double ms) {
+    if (enabled) {
+      current[static_cast<size_t>(phase)] += ms;
+      ran[static_cast<size_t>(phase)] = true;
+    }
+  }
+
+  // Closes the current frame: records its phase times and the time since the last EndFrame.
+  void EndFrame();
+
+  [[nodiscard]] Stats GetStats(Phase phase) const;
+
+  static const char* GetPhaseName(Phase phase);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t kPhaseCount = static_cast<size_t>(Phase::kCount);
+
+  inline void Add(const Phase phase, const Clock::duration elapsed) {
+    AddTime(phase, std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+
+  void Reset();
+
+  bool enabled = false;
+  std::array<double, kPhaseCount> current{};
+  std::array<bool, kPhaseCount> ran{};
+  Clock::time_point frameStart;
+
+  // per phase, the last kWindow frames it ran in
+  std::array<std::vector<double>, kPhaseCount> history;
+  std::array<size_t, kPhaseCount> historyNext{};
+
+  std::ofstream log;
+  uint64_t frameCount = 0;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_FRAME_PROFILER_H_
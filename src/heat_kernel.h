@@ -0,0 +1,50 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_HEAT_KERNEL_H_
+#define RAYLIB_SAND_SIM_SRC_HEAT_KERNEL_H_
+
+#include <cstdint>
+
+// One explicit diffusion step over a row of heat values. Each cell exchanges heat with its four
+// neighbours: between two cells, min(conductivity) / 256 of the difference flows towards the
+// cooler one, rounded down, so small leftovers drift back to ambient (0) instead of lingering.
+// On x86 with AVX2 the row is done 16 cells at a time in 16-bit lanes; the results are identical
+// to the scalar loop.
+class HeatKernel {
+ public:
+  enum class Isa {
+    kScalar,
+    kAvx2,
+  };
+
+  // Keeps the four flows out of a cell from taking more than it holds.
+  static constexpr int kMaxConductivity = 64;
+
+  // Uses AVX2 if the CPU supports it, unless told not to.
+  explicit HeatKernel(Isa isa = DetectIsa());
+
+  // heat and conductivity point at the first cell of a row inside a padded tile whose rows are
+  // stride apart, so the cells either side and above and below every cell in the row can be
+  // read. Conductivities must be at most kMaxConductivity.
+  inline void DiffuseRow(const uint8_t* heat, const uint8_t* conductivity, const int stride, uint8_t* out, const int count) const {
+    diffuseRow(heat, conductivity, stride, out, count);
+  }
+
+  [[nodiscard]] inline Isa GetIsa() const { return isa; }
+
+  static Isa DetectIsa();
+  static const char* GetIsaName(Isa isa);
+
+ private:
+  using DiffuseRowFn = void (*)(const uint8_t* heat, const uint8_t* conductivity, int stride, uint8_t* out, int count);
+
+  static void DiffuseRowScalar(const uint8_t* heat, const uint8_t* conductivity, int stride, uint8_t* out, int count);
+  static void DiffuseRowAvx2(const uint8_t* heat, const uint8_t* conductivity, int stride, uint8_t* out, int count);
+
+  Isa isa;
+  DiffuseRowFn diffuseRow;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_HEAT_KERNEL_H_
@@ -6,11 +6,20 @@
 #include "raygui.h"
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
-#include <array>
-#include <cstdint>
-#include <nlohmann/json.hpp>
-#include <fstream>
+#include "automata_matrix.h"
+#include "frame_profiler.h"
+#include "recording.h"
+#include "simulation_thread.h"
+#include "world_texture.h"
 
 enum class GameState {
   kMainMenu,
@@ -25,268 +34,85 @@ enum class PlayState {
   kPaused,
 };
 
-Color particleColors[] = {
-    BLACK, // AIR
-    BEIGE, // SAND
-    GRAY,  // STONE
-    BLUE,  // WATER
-    DARKGRAY, // BEDROCK
+// Command line settings for a run of the game.
+struct AppOptions {
+  int simulationThreads = 1; // > 1 runs the world in checkerboard mode on that many threads
+  uint64_t seed = 0;
+  std::string recordPath;    // save the seed and every painting action here on exit
+  std::string replayPath;    // re-run this recording headless instead of opening a window
+  std::string elementsPath;  // override the compiled-in element properties with this JSON file
+  std::string snapshotPath = "world.snap"; // F5 saves the world here, F9 loads it back
+  std::string profilePath;   // time every frame's phases and write them here as CSV
+  bool verifyCounts = false; // recount every element after each tick and complain if the kept counts drift
+  int maxTicksPerFrame = 4;  // ticks the simulation may run at once to catch up before time is dropped
 };
 
-class Cell {
-public:
-  enum class Element : uint8_t {
-    kAir,
-    kSand,
-    kStone,
-    kWater,
-    //kLava,
-    //kDirt,
-    kBedrock,
-    kCount,
-  };
-
-  enum class Type : uint8_t {
-    kEmpty,
-    kPowder,
-    kSolid,
-    kLiquid,
-    kFire,
-    kGas,
-  };
-
-  static void LoadElements(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-      throw std::runtime_error("Failed to open file: " + filename);
-    }
-
-    nlohmann::json json;
-    file >> json;
-
-    if (!json.contains("elements") || !json["elements"].is_array()) {
-      throw std::runtime_error("Invalid JSON config format: " + filename);
-    }
-    if (json["elements"].size() != static_cast<size_t>(Cell::Element::kCount)-1) {
-      throw std::runtime_error("Invalid number of elements in JSON config: " + filename);
-    }
-
-    for (const auto& element : json["elements"]) {
-      auto i = static_cast<size_t>(element["index"]);
-      types[i] = static_cast<Cell::Type>(element["type"]);
-      weights[i] = element["weight"];
-      viscosity[i] = element["viscosity"];
-      names[i] = element["name"];
-      colors[i] = particleColors[i];
-    }
-  }
-
-  static Type GetType(Element element) {
-    return types[static_cast<size_t>(element)];
-  }
-
-  static Color GetColor(Element element) {
-    return colors[static_cast<size_t>(element)];
-  }
-
-  static int GetWeight(Element element) {
-    return weights[static_cast<size_t>(element)];
-  }
-
-  static int GetViscosity(Element element) {
-    return viscosity[static_cast<size_t>(element)];
-  }
-
-  static std::string GetName(Element element) {
-    return names[static_cast<size_t>(element)];
-  }
-
-private:
-  static std::array<Type,        static_cast<size_t>(Element::kCount)> types;
-  static std::array<Color,       static_cast<size_t>(Element::kCount)> colors;
-  static std::array<int,         static_cast<size_t>(Element::kCount)> weights;
-  static std::array<int,         static_cast<size_t>(Element::kCount)> viscosity;
-  static std::array<std::string, static_cast<size_t>(Element::kCount)> names;
-};
-
-class AutomataMatrix {
-public:
-  AutomataMatrix(int width = 400, int height = 300) : width(width), height(height) {
-    cell.resize(width * height);
-    heat.resize(width * height);
-    shade.resize(width * height);
-    dirty.resize(width * height);
-
-    for (int y = 0; y < height; y++) {
-      for (int x = 0; x < width; x++) {
-        if (x == 0 || x == width - 1 || y == 0 || y == height - 1) {
-          cell[y*width + x] = Cell::Element::kBedrock;
-        } else {
-          cell[y*width + x] = Cell::Element::kAir;
-        }
-
-        heat[y*width + x] = 0;
-        shade[y*width + x] = 0;
-        dirty[y*width + x] = 1;
-      }
-    }
-  }
-
-  [[nodiscard]] inline int GetWidth()  const { return width; }
-  [[nodiscard]] inline int GetHeight() const { return height; }
-
-  [[nodiscard]] inline int Above     (const int pos) const { return pos + width; }
-  [[nodiscard]] inline int Below     (const int pos) const { return pos - width; }
-  [[nodiscard]] inline int Right     (const int pos) const { return pos + 1; }
-  [[nodiscard]] inline int Left      (const int pos) const { return pos - 1; }
-  [[nodiscard]] inline int AboveRight(const int pos) const { return pos + width + 1; }
-  [[nodiscard]] inline int AboveLeft (const int pos) const { return pos + width - 1; }
-  [[nodiscard]] inline int BelowRight(const int pos) const { return pos - width + 1; }
-  [[nodiscard]] inline int BelowLeft (const int pos) const { return pos - width - 1; }
-
-  void SetCell(const int pos, const Cell::Element element) {
-    cell[pos] = element;
-  }
-
-  void SetCell(const int x, const int y, const Cell::Element element) {
-    cell[y*width + x] = element;
-  }
-
-  void SwapCells(const int pos1, const int pos2) {
-    std::swap(cell[pos1], cell[pos2]);
-  }
-
-  void SwapCells(const int x1, const int y1, const int x2, const int y2) {
-    std::swap(cell[y1*width + x1], cell[y2*width + x2]);
-  }
-
-  void ApplyGravity(int pos, Cell::Element element, const int direction, const bool liquid) {
-    int weight = Cell::GetWeight(element);
-    while (weight-- != 0) {
-      const int below = Below(pos);
-      const int directionA = direction ? BelowRight(pos) : BelowLeft(pos);
-      const int directionB = direction ? BelowLeft(pos) : BelowRight(pos);
-      if (Cell::GetType(cell[below]) == Cell::Type::kEmpty) {
-        SwapCells(pos, below);
-        pos = below;
-      } else if (Cell::GetType(cell[directionA]) == Cell::Type::kEmpty) {
-        SwapCells(pos, directionA);
-        pos = directionA;
-      } else if (Cell::GetType(cell[directionB]) == Cell::Type::kEmpty) {
-        SwapCells(pos, directionB);
-        pos = directionB;
-      } else {
-        if (liquid) {
-          ApplySpread(pos, weight, direction);
-        }
-        break;
-      }
-    }
-    dirty[pos] = 0;
-  }
-
-  void ApplySpread(int& pos, int spread, const int direction) {
-    while (spread-- != 0) {
-      const int directionA = direction ? Right(pos) : Left(pos);
-      const int directionB = direction ? Left(pos) : Right(pos);
-      if (Cell::GetType(cell[directionA]) == Cell::Type::kEmpty) {
-        SwapCells(pos, directionA);
-        pos = directionA;
-      } else if (Cell::GetType(cell[directionB]) == Cell::Type::kEmpty) {
-        SwapCells(pos, directionB);
-        pos = directionB;
+// Sand in the top left and a column of water drops, shared by the game and replays.
+void LayOutStartingScene(AutomataMatrix& world) {
+  const int width = world.GetWidth();
+  const int height = world.GetHeight();
+  for (int y = 1; y < height - 1; y++) {
+    for (int x = 1; x < width - 1; x++) {
+      if (y < height / 3 && x < width / 2) {
+        world.SetCell(x, y, Cell::Element::kSand);
+      } else if (y%2 == 0 && x == width/2) {
+        world.SetCell(x, y, Cell::Element::kWater);
       }
     }
   }
-
-  void Update() {
-    const int direction = GetRandomValue(0, 1);
-    for (int i = 0; i < width*height; i++) {
-      switch(cell[i]) {
-        case Cell::Element::kSand: {
-          ApplyGravity(i, Cell::Element::kSand, direction, false);
-          break;
-        }
-        case Cell::Element::kWater: {
-          ApplyGravity(i, Cell::Element::kWater, direction, true);
-          break;
-        }
-        default:
-          break;
-      }
-    }
-    std::ranges::fill(dirty, 1);
-  }
-
-private:
-  int width;
-  int height;
-
-  std::vector<Cell::Element> cell;
-  std::vector<uint8_t>       heat;
-  std::vector<uint8_t>       shade;
-  std::vector<uint8_t>       dirty;
-};
-
-
-enum class Particle {
-  kAir,
-  kSand,
-  kStone,
-  kWater,
-  kBedrock,
-  kCount,
-};
+}
 
 class Application {
 public:
-  Application() {
+  explicit Application(const AppOptions& options) {
     // setup raylib
     SetConfigFlags(FLAG_VSYNC_HINT);
     InitWindow(screenWidth, screenHeight, "Falling Sand Simulation");
-    SetTargetFPS(60);
-
-    // allocate particle array to represent world and pixel array for rendering
-    world = std::make_unique<Particle[]>(worldWidth * worldHeight);
-    for (int y = 0; y < worldHeight; y++) {
-      for (int x = 0; x < worldWidth; x++) {
-        if (x == 0 || x == worldWidth - 1 || y == 0 || y == worldHeight - 1) {
-          world[y * worldWidth + x] = Particle::kBedrock;
-        } else if (y < worldHeight / 3 && x < worldWidth / 2) {
-          world[y * worldWidth + x] = Particle::kSand;
-        } else if (y%2 == 0 && x == worldWidth/2) {//x > worldWidth/2-3 && x < worldWidth/2+3) {
-          world[y*worldWidth + x] = Particle::kWater;
-        }
-        else {
-          world[y*worldWidth + x] = Particle::kAir;
-        }
-      }
+
+    // override the compiled-in element properties and lay out the starting scene
+    if (!options.elementsPath.empty()) {
+      Cell::LoadElements(options.elementsPath);
     }
+    LayOutStartingScene(world);
 
-    // allocate and initialize dirty map
-    dirtyMap = std::make_unique<uint8_t[]>(worldWidth * worldHeight);
-    std::fill_n(dirtyMap.get(), worldWidth * worldHeight, 1);
+    world.SetSeed(options.seed);
+    world.SetVerifyPopulation(options.verifyCounts);
+    if (options.simulationThreads > 1) {
+      world.SetUpdateMode(AutomataMatrix::UpdateMode::kCheckerboard, options.simulationThreads);
+    }
+
+    recordPath = options.recordPath;
+    profilePath = options.profilePath;
+    recording.seed = options.seed;
+    recording.width = worldWidth;
+    recording.height = worldHeight;
+    recording.updateMode = world.GetUpdateMode();
+
+    // from here on the world belongs to the simulation thread
+    simulation = std::make_unique<SimulationThread>(world, recordPath.empty() ? nullptr : &recording,
+                                                    options.snapshotPath, options.maxTicksPerFrame);
 
     // setup world texture
-    pixels = std::make_unique<Color[]>(worldWidth * worldHeight);
-    for (int y = 0; y < worldHeight; y++) {
-      for (int x = 0; x < worldWidth; x++) {
-        pixels[y*worldWidth + x] = particleColors[static_cast<int>(world[y*worldWidth + x])];
-      }
+    worldTexture = std::make_unique<WorldTexture>(simulation->GetFrame());
+    worldTexture->SetProfiler(&profiler);
+
+    // frame timings are only gathered while the overlay is up or a log is being written
+    if (!options.profilePath.empty()) {
+      profiler.OpenLog(options.profilePath);
     }
-    worldImage = {
-        .data = pixels.get(),
-        .width = worldWidth,
-        .height = worldHeight,
-        .mipmaps = 1,
-        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
-    };
-    worldTexture = LoadTextureFromImage(worldImage);
-    //UnloadImage(worldImage);
   }
 
   ~Application() {
-    UnloadTexture(worldTexture);
+    simulation.reset();
+    if (!recordPath.empty()) {
+      recording.tickCount = world.GetTick();
+      try {
+        recording.Save(recordPath);
+      } catch (const std::exception& e) {
+        TraceLog(LOG_ERROR, "%s", e.what());
+      }
+    }
+    worldTexture.reset();
     CloseWindow();
   }
 
@@ -307,233 +133,169 @@ public:
     }
   }
 
-  void UpdateWorldTexture() {
-    for (int y = 0; y < worldHeight; y++) {
-      for (int x = 0; x < worldWidth; x++) {
-        pixels[y*worldWidth + x] = particleColors[static_cast<int>(world[y*worldWidth + x])];
-      }
-    }
-    UpdateTexture(worldTexture, pixels.get());
-  }
-
-  void DrawWorld() {
-    ClearBackground(BLACK);
-
-    for (int i = 0; i < worldWidth * worldHeight; i++) {
-      pixels[i] = particleColors[static_cast<int>(world[i])];
+  void Render() {
+    if (state == GameState::kPlaying && simulation->AcquireFrame()) {
+      const WorldFrame& frame = simulation->GetFrame();
+      profiler.AddTime(FrameProfiler::Phase::kSimulation, frame.simulationMs);
+      worldTexture->Update(frame);
     }
 
-    // Calculate scaling factor based on window size and framebuffer size
-    float scaleFactorX = (float)GetScreenWidth() / worldWidth;
-    float scaleFactorY = (float)GetScreenHeight() / worldHeight;
-
-    // Determine the smaller scale factor to maintain aspect ratio
-    float scaleFactor = fminf(scaleFactorX, scaleFactorY);
-
-    float scaledWidth = worldWidth * scaleFactor;
-    float scaledHeight = worldHeight * scaleFactor;
-    float offsetX = (GetScreenWidth() - scaledWidth) / 2.0f;
-    float offsetY = (GetScreenHeight() - scaledHeight) / 2.0f;
-
-    DrawTexturePro(
-        worldTexture,
-        (Rectangle){ 0, 0, (float)worldTexture.width, -(float)worldTexture.height }, // Source rectangle (inverted Y)
-        (Rectangle){ offsetX, offsetY, scaledWidth, scaledHeight },                  // Destination rectangle
-        (Vector2){ 0, 0 },                                                           // Origin
-        0.0f,                                                                        // Rotation
-        WHITE                                                                        // Tint
-    );
-  }
-
-  void Render() {
     BeginDrawing();
-    ClearBackground(PURPLE);
-    switch (state) {
-      case GameState::kMainMenu:
-        DrawMainMenu();
-        break;
-      case GameState::kOptionsMenu:
-        break;
-      case GameState::kPlaying:
-        UpdateWorldTexture();
-        DrawWorld();
-        break;
+    {
+      FrameProfiler::Scope timer(&profiler, FrameProfiler::Phase::kDraw);
+      ClearBackground(PURPLE);
+      switch (state) {
+        case GameState::kMainMenu:
+          DrawMainMenu();
+          break;
+        case GameState::kOptionsMenu:
+          break;
+        case GameState::kPlaying:
+          ClearBackground(BLACK);
+          worldTexture->Draw();
+          DrawBrushOutline();
+          break;
+      }
+      DrawFPS(10, 10);
+      if (showProfiler) {
+        DrawProfiler();
+      }
+      if (showPopulation && state == GameState::kPlaying) {
+        DrawPopulation();
+      }
     }
-    DrawFPS(10, 10);
     EndDrawing();
-  }
-
-  [[nodiscard]] inline int Above     (int pos) const { return pos + worldWidth; }
-  [[nodiscard]] inline int Below     (int pos) const { return pos - worldWidth; }
-  [[nodiscard]] inline int Right     (int pos) const { return pos + 1; }
-  [[nodiscard]] inline int Left      (int pos) const { return pos - 1; }
-  [[nodiscard]] inline int AboveRight(int pos) const { return pos + worldWidth + 1; }
-  [[nodiscard]] inline int AboveLeft (int pos) const { return pos + worldWidth - 1; }
-  [[nodiscard]] inline int BelowRight(int pos) const { return pos - worldWidth + 1; }
-  [[nodiscard]] inline int BelowLeft (int pos) const { return pos - worldWidth - 1; }
-
-  inline void SetParticle(int pos, Particle type) {
-    world[pos] = type;
-  }
-
-  inline void SwapParticle(int newPos, Particle newType, int oldPos, Particle oldType) {
-    world[newPos] = newType;
-    world[oldPos] = oldType;
-  }
-
-  void ApplyGravity(int pos, Particle type, int weight, int direction) {
-    int tempPos = pos;
-    while (weight-- != 0) {
-      int below = Below(pos);
-      if (world[below] == Particle::kAir) {
-        SwapParticle(pos, Particle::kAir, below, type);
-        tempPos = below;
-        continue;
-      } else {
-        int belowRight = BelowRight(pos);
-        int belowLeft = BelowLeft(pos);
-        if (direction == 0) {
-          if (world[belowRight] == Particle::kAir) {
-            SwapParticle(pos, Particle::kAir, belowRight, type);
-            pos = belowRight;
-          } else if (world[belowLeft] == Particle::kAir) {
-            SwapParticle(pos, Particle::kAir, belowLeft, type);
-            pos = belowLeft;
-          }
-        } else {
-          if (world[belowLeft] == Particle::kAir) {
-            SwapParticle(pos, Particle::kAir, belowLeft, type);
-            pos = belowLeft;
-          } else if (world[belowRight] == Particle::kAir) {
-            SwapParticle(pos, Particle::kAir, belowRight, type);
-            pos = belowRight;
-          }
-        }
-      }
+    profiler.EndFrame();
+  }
+
+  // Where the brush will paint, at the world's scale.
+  void DrawBrushOutline() {
+    const Vector2 mousePos = GetMousePosition();
+    const float scaleFactor = fminf((float)screenWidth / worldWidth, (float)screenHeight / worldHeight);
+    const float reach = (brushRadius + 0.5f) * scaleFactor;
+    if (brushShape == Brush::Shape::kCircle) {
+      DrawCircleLines(mousePos.x, mousePos.y, reach, RAYWHITE);
+    } else {
+      DrawRectangleLinesEx((Rectangle){mousePos.x - reach, mousePos.y - reach, 2*reach, 2*reach}, 1, RAYWHITE);
     }
   }
 
-
-
-  void CalculateGravity(int& pos, Particle type, int& fallFactor, int fallDirection, bool calculateSpread = false) {
-    while (fallFactor-- != 0) {
-      int below = Below(pos); // Store the result in a temporary variable
-      if (world[below] == Particle::kAir) {
-        SwapParticle(pos, Particle::kAir, below, type);
-        pos = below;
-        continue;
-      }
-      int belowRight = BelowRight(pos);
-      int belowLeft = BelowLeft(pos);
-      if (fallDirection == 0) {
-        if (world[belowRight] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, belowRight, type);
-          pos = belowRight;
-        } else if (world[belowLeft] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, belowLeft, type);
-          pos = belowLeft;
-        } else {
-          if (calculateSpread) {
-            CalculateSpread(pos, type, 1, fallDirection);
-          }
-        }
-      } else {
-        if (world[belowLeft] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, belowLeft, type);
-          pos = belowLeft;
-        } else if (world[belowRight] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, belowRight, type);
-          pos = belowRight;
-        } else {
-          if (calculateSpread) {
-            CalculateSpread(pos, type, 1, fallDirection);
-          }
-        }
-      }
+  // Cells of each element in the world and in the chunk under the mouse, as of the last frame
+  // the simulation published.
+  void DrawPopulation() {
+    constexpr int kWidth = 300;
+    constexpr int kLineHeight = 20;
+    constexpr int kFontSize = 18;
+    const int left = screenWidth - kWidth - 10;
+    const int columns[] = {left + 8, left + 110, left + 210};
+    constexpr int kTop = 10;
+    constexpr int kElementCount = static_cast<int>(Cell::Element::kCount);
+
+    const WorldFrame& frame = simulation->GetFrame();
+    const Vector2 worldPos = ScreenToWorld(GetMousePosition());
+    const int chunksX = (worldWidth + AutomataMatrix::kChunkSize - 1) / AutomataMatrix::kChunkSize;
+    const int chunk = (static_cast<int>(worldPos.y) / AutomataMatrix::kChunkSize) * chunksX +
+                      static_cast<int>(worldPos.x) / AutomataMatrix::kChunkSize;
+
+    DrawRectangle(left, kTop, kWidth, (kElementCount + 1) * kLineHeight + 8, Fade(BLACK, 0.7f));
+    int y = kTop + 4;
+    DrawText("element", columns[0], y, kFontSize, LIGHTGRAY);
+    DrawText("world", columns[1], y, kFontSize, LIGHTGRAY);
+    DrawText("chunk", columns[2], y, kFontSize, LIGHTGRAY);
+    for (int i = 0; i < kElementCount; i++) {
+      y += kLineHeight;
+      const auto element = static_cast<Cell::Element>(i);
+      DrawText(Cell::GetName(element).c_str(), columns[0], y, kFontSize, Cell::GetColor(element));
+      DrawText(TextFormat("%lld", static_cast<long long>(frame.population[i])), columns[1], y, kFontSize, RAYWHITE);
+      DrawText(TextFormat("%d", frame.chunkPopulation[chunk * element_tables::kCount + i]), columns[2], y, kFontSize,
+               RAYWHITE);
     }
   }
 
-  void CalculateSpread(int& pos, Particle type, int spreadFactor, int spreadDirection) {
-    while (spreadFactor-- != 0) {
-      int right = Right(pos);
-      int left = Left(pos);
-      if (spreadDirection == 0) {
-        if (world[right] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, right, type);
-          pos = right;
-        } else if (world[left] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, left, type);
-          pos = left;
-        }
-      } else {
-        if (world[left] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, left, type);
-          pos = left;
-        } else if (world[right] == Particle::kAir) {
-          SwapParticle(pos, Particle::kAir, right, type);
-          pos = right;
-        }
+  // Rolling min, average and 99th percentile of each frame phase, in milliseconds.
+  void DrawProfiler() {
+    constexpr int kLeft = 10;
+    constexpr int kTop = 34;
+    constexpr int kLineHeight = 20;
+    constexpr int kFontSize = 18;
+    constexpr int kColumns[] = {kLeft + 8, kLeft + 130, kLeft + 200, kLeft + 270};
+    constexpr int kPhaseCount = static_cast<int>(FrameProfiler::Phase::kCount);
+
+    DrawRectangle(kLeft, kTop, 340, (kPhaseCount + 2) * kLineHeight + 8, Fade(BLACK, 0.7f));
+    int y = kTop + 4;
+    DrawText("phase", kColumns[0], y, kFontSize, LIGHTGRAY);
+    DrawText("min", kColumns[1], y, kFontSize, LIGHTGRAY);
+    DrawText("avg", kColumns[2], y, kFontSize, LIGHTGRAY);
+    DrawText("p99", kColumns[3], y, kFontSize, LIGHTGRAY);
+    for (int i = 0; i < kPhaseCount; i++) {
+      y += kLineHeight;
+      const auto phase = static_cast<FrameProfiler::Phase>(i);
+      const FrameProfiler::Stats stats = profiler.GetStats(phase);
+      DrawText(FrameProfiler::GetPhaseName(phase), kColumns[0], y, kFontSize, RAYWHITE);
+      if (stats.samples == 0) {
+        continue;
       }
+      DrawText(TextFormat("%.2f", stats.minMs), kColumns[1], y, kFontSize, RAYWHITE);
+      DrawText(TextFormat("%.2f", stats.avgMs), kColumns[2], y, kFontSize, RAYWHITE);
+      DrawText(TextFormat("%.2f", stats.p99Ms), kColumns[3], y, kFontSize, RAYWHITE);
     }
+    y += kLineHeight;
+    DrawText(TextFormat("ticks dropped %llu", static_cast<unsigned long long>(simulation->GetFrame().droppedTicks)),
+             kColumns[0], y, kFontSize, LIGHTGRAY);
   }
 
-  void UpdatePowder(int pos, Particle type, int fallFactor, int fallDirection) {
-    CalculateGravity(pos, type, fallFactor, fallDirection);
-  }
-
-  void UpdateLiquid(int pos, Particle type, int fallFactor, int fallDirection) {
-    CalculateGravity(pos, type, fallFactor, fallDirection, true);
-  }
-
-  void UpdateWorld(double elapsedTicks) {
+  // Passes the brush and snapshot keys on to the simulation, which ticks only while playing.
+  // The mouse wheel sizes the brush and tab switches its shape.
+  void HandleInput() {
+    simulation->SetRunning(state == GameState::kPlaying);
     if (state != GameState::kPlaying) {
       return;
     }
 
+    FrameProfiler::Scope timer(&profiler, FrameProfiler::Phase::kInput);
+    const float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f) {
+      brushRadius = std::clamp(brushRadius + (wheel > 0.0f ? 1 : -1), 0, Brush::kMaxRadius);
+    }
+    if (IsKeyPressed(KEY_TAB)) {
+      brushShape = brushShape == Brush::Shape::kCircle ? Brush::Shape::kSquare : Brush::Shape::kCircle;
+    }
+
+    const Vector2 worldPos = ScreenToWorld(GetMousePosition());
+    SimulationThread::BrushState brush{static_cast<int>(worldPos.x), static_cast<int>(worldPos.y),
+                                       Cell::Element::kAir, false, brushRadius, brushShape};
     if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-      Vector2 mousePos = GetMousePosition();
-      Vector2 worldPos = ScreenToWorld(mousePos);
-      if (world[GetIndex(worldPos.x, worldPos.y)] != Particle::kBedrock) {
-        SetParticle(GetIndex(worldPos.x, worldPos.y), Particle::kSand);
-      }
+      brush.element = Cell::Element::kSand;
+      brush.down = true;
     } else if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-      Vector2 mousePos = GetMousePosition();
-      Vector2 worldPos = ScreenToWorld(mousePos);
-      if (world[GetIndex(worldPos.x, worldPos.y)] != Particle::kBedrock) {
-        SetParticle(GetIndex(worldPos.x, worldPos.y), Particle::kWater);
-      }
+      brush.element = Cell::Element::kWater;
+      brush.down = true;
     }
+    simulation->SetBrush(brush);
 
-    int fallDirection = GetRandomValue(0, 1);
-    for (int i = worldWidth; i < worldWidth*worldHeight-worldWidth; i++) {
-      switch(world[i]) {
-        case Particle::kSand: {
-          UpdatePowder(i, Particle::kSand, 4, fallDirection);
-          break;
-        }
-        case Particle::kWater: {
-          UpdateLiquid(i, Particle::kWater, 8, fallDirection);
-          break;
-        }
-        default:
-          break;
-      }
+    if (IsKeyPressed(KEY_F5)) {
+      simulation->SaveSnapshot();
+    } else if (IsKeyPressed(KEY_F9)) {
+      simulation->LoadSnapshot();
     }
   }
 
+  // F3 shows or hides the frame timings. Timing stays on while a log is being written.
+  void ToggleProfiler() {
+    showProfiler = !showProfiler;
+    profiler.SetEnabled(showProfiler || !profilePath.empty());
+  }
+
+  // Draws as fast as vsync allows while the simulation ticks at its own rate on its own thread.
   void Run() {
-    double previous = GetTime();
-    double lag = 0.0;
-    const double ticksMS = 1.0/60.0;
     while (!WindowShouldClose()) {
-      double current = GetTime();
-      double elapsed = current - previous;
-      previous = current;
-      lag += elapsed;
-      if (lag >= ticksMS) {
-        UpdateWorld(elapsed);
-        lag -= ticksMS;
+      if (IsKeyPressed(KEY_F3)) {
+        ToggleProfiler();
       }
+      if (IsKeyPressed(KEY_F4)) {
+        showPopulation = !showPopulation;
+      }
+      HandleInput();
       Render();
     }
   }
@@ -591,23 +353,108 @@ private:
 
   int worldWidth = 400;
   int worldHeight = 300;
-  std::unique_ptr<Particle[]> world;
-  std::unique_ptr<uint8_t[]> dirtyMap;
-  std::unique_ptr<Color[]> pixels;
-  Image worldImage = {
-      .data = nullptr,
-      .width = worldWidth,
-      .height = worldHeight,
-      .mipmaps = 1,
-      .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
-  };
-  Texture2D worldTexture;
+  AutomataMatrix world{worldWidth, worldHeight};
+  std::unique_ptr<WorldTexture> worldTexture;
+
+  std::string recordPath;
+  Recording recording;
+
+  std::unique_ptr<SimulationThread> simulation;
+  int brushRadius = 2;
+  Brush::Shape brushShape = Brush::Shape::kCircle;
+
+  std::string profilePath;
+  FrameProfiler profiler;
+  bool showProfiler = false;
+  bool showPopulation = false;
 
   GameState state = GameState::kMainMenu;
 };
 
+// Plays a recording back as fast as possible without opening a window. Each action is applied
+// before the tick it was recorded on, so the final hash matches the recorded session.
+int Replay(const AppOptions& options) {
+  const Recording recording = Recording::Load(options.replayPath);
+  if (!options.elementsPath.empty()) {
+    Cell::LoadElements(options.elementsPath);
+  }
+
+  AutomataMatrix world{recording.width, recording.height};
+  LayOutStartingScene(world);
+  world.SetSeed(recording.seed);
+  world.SetVerifyPopulation(options.verifyCounts);
+  if (recording.updateMode == AutomataMatrix::UpdateMode::kCheckerboard) {
+    world.SetUpdateMode(recording.updateMode, options.simulationThreads);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  Brush brush;
+  size_t next = 0;
+  while (world.GetTick() < recording.tickCount) {
+    for (; next < recording.actions.size() && recording.actions[next].tick <= world.GetTick(); next++) {
+      const Recording::Action& action = recording.actions[next];
+      brush.SetRadius(action.radius);
+      brush.SetShape(action.shape);
+      brush.Stroke(world, action.x0, action.y0, action.x1, action.y1, action.element);
+    }
+    world.Update();
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::printf("ticks %llu  actions %zu  elapsed %.3f s  ticks/sec %.1f  hash %016llx\n",
+              static_cast<unsigned long long>(world.GetTick()), recording.actions.size(), seconds,
+              seconds > 0 ? world.GetTick() / seconds : 0.0, static_cast<unsigned long long>(world.HashCells()));
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
-  Application app;
+  // --threads N runs the simulation on N threads, 0 picks one per hardware thread
+  // --seed N fixes the simulation's random choices, otherwise every run gets a fresh seed
+  // --record FILE saves the seed and every brush stroke to FILE on exit
+  // --replay FILE re-runs a recording headless and prints the final world hash and timing
+  // --elements FILE replaces the compiled-in element properties with the ones in FILE
+  // --snapshot FILE is where F5 saves the world and F9 loads it from (world.snap by default)
+  // --profile FILE writes how long each phase of every frame took to FILE as CSV (F3 shows them)
+  // --verify-counts recounts every element after each tick and reports the first time the kept counts are off
+  // --catch-up N lets the simulation run up to N ticks at once to keep up with the clock (4 by default)
+  AppOptions options;
+  options.seed = std::random_device{}();
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      options.simulationThreads = std::atoi(argv[++i]);
+      if (options.simulationThreads <= 0) {
+        options.simulationThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+      }
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--record" && i + 1 < argc) {
+      options.recordPath = argv[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      options.replayPath = argv[++i];
+    } else if (arg == "--elements" && i + 1 < argc) {
+      options.elementsPath = argv[++i];
+    } else if (arg == "--snapshot" && i + 1 < argc) {
+      options.snapshotPath = argv[++i];
+    } else if (arg == "--profile" && i + 1 < argc) {
+      options.profilePath = argv[++i];
+    } else if (arg == "--verify-counts") {
+      options.verifyCounts = true;
+    } else if (arg == "--catch-up" && i + 1 < argc) {
+      options.maxTicksPerFrame = std::max(std::atoi(argv[++i]), 1);
+    }
+  }
+
+  if (!options.replayPath.empty()) {
+    try {
+      return Replay(options);
+    } catch (const std::exception& e) {
+      std::fprintf(stderr, "%s\n", e.what());
+      return 1;
+    }
+  }
+
+  Application app(options);
   app.Run();
 
   return 0;
@@ -0,0 +1,30 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_RANDOM_H_
+#define RAYLIB_SAND_SIM_SRC_RANDOM_H_
+
+#include <cstdint>
+
+// Counter based random numbers built on the SplitMix64 finalizer: the value is a pure function
+// of its inputs, so it comes out the same whichever thread asks for it and in whatever order.
+class Random {
+ public:
+  Random() = delete;
+
+  static constexpr uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  static constexpr uint64_t Hash(const uint64_t key, const uint64_t counter) {
+    return Mix(key ^ Mix(counter * kGolden + kGolden));
+  }
+
+ private:
+  static constexpr uint64_t kGolden = 0x9e3779b97f4a7c15ull;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_RANDOM_H_
@@ -0,0 +1,155 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "recording.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'S', 'R', 'C'};
+
+template <typename T>
+void WriteInt(std::ostream& out, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    out.put(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+  }
+}
+
+void WriteVarint(std::ostream& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.put(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.put(static_cast<char>(value));
+}
+
+uint8_t ReadByte(std::istream& in, const std::string& filename) {
+  const int byte = in.get();
+  if (byte == std::char_traits<char>::eof()) {
+    throw std::runtime_error("Unexpected end of recording: " + filename);
+  }
+  return static_cast<uint8_t>(byte);
+}
+
+template <typename T>
+T ReadInt(std::istream& in, const std::string& filename) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    value |= static_cast<uint64_t>(ReadByte(in, filename)) << (8 * i);
+  }
+  return static_cast<T>(value);
+}
+
+uint64_t ReadVarint(std::istream& in, const std::string& filename) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    const uint8_t byte = ReadByte(in, filename);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw std::runtime_error("Corrupt varint in recording: " + filename);
+}
+
+} // namespace
+
+void Recording::Save(const std::string& filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  file.write(kMagic, sizeof(kMagic));
+  WriteInt<uint16_t>(file, kVersion);
+  WriteInt<uint64_t>(file, seed);
+  WriteInt<int32_t>(file, width);
+  WriteInt<int32_t>(file, height);
+  WriteInt<uint8_t>(file, static_cast<uint8_t>(updateMode));
+  WriteInt<uint64_t>(file, tickCount);
+  WriteInt<uint64_t>(file, actions.size());
+
+  uint64_t previousTick = 0;
+  for (const Action& action : actions) {
+    WriteVarint(file, action.tick - previousTick);
+    WriteVarint(file, static_cast<uint64_t>(action.x0));
+    WriteVarint(file, static_cast<uint64_t>(action.y0));
+    WriteVarint(file, static_cast<uint64_t>(action.x1));
+    WriteVarint(file, static_cast<uint64_t>(action.y1));
+    WriteInt<uint8_t>(file, static_cast<uint8_t>(action.radius));
+    WriteInt<uint8_t>(file, static_cast<uint8_t>(action.shape));
+    WriteInt<uint8_t>(file, static_cast<uint8_t>(action.element));
+    previousTick = action.tick;
+  }
+
+  if (!file.good()) {
+    throw std::runtime_error("Failed to write recording: " + filename);
+  }
+}
+
+Recording Recording::Load(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+
+  char magic[sizeof(kMagic)];
+  if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kMagic)) {
+    throw std::runtime_error("Not a recording: " + filename);
+  }
+  const auto version = ReadInt<uint16_t>(file, filename);
+  if (version != 1 && version != kVersion) {
+    throw std::runtime_error("Unsupported recording version: " + filename);
+  }
+
+  Recording recording;
+  recording.seed = ReadInt<uint64_t>(file, filename);
+  recording.width = ReadInt<int32_t>(file, filename);
+  recording.height = ReadInt<int32_t>(file, filename);
+  recording.updateMode = static_cast<AutomataMatrixBase::UpdateMode>(ReadInt<uint8_t>(file, filename));
+  recording.tickCount = ReadInt<uint64_t>(file, filename);
+  if (recording.width < 3 || recording.height < 3) {
+    throw std::runtime_error("Invalid world size in recording: " + filename);
+  }
+
+  const auto actionCount = ReadInt<uint64_t>(file, filename);
+  // checked before narrowing, so a huge varint can't wrap into range or go negative
+  const auto readCoordinate = [&](const int32_t size) {
+    const uint64_t value = ReadVarint(file, filename);
+    if (value >= static_cast<uint64_t>(size)) {
+      throw std::runtime_error("Invalid action in recording: " + filename);
+    }
+    return static_cast<int>(value);
+  };
+  uint64_t tick = 0;
+  for (uint64_t i = 0; i < actionCount; i++) {
+    Action action{};
+    tick += ReadVarint(file, filename);
+    action.tick = tick;
+    action.x0 = readCoordinate(recording.width);
+    action.y0 = readCoordinate(recording.height);
+    if (version == 1) {
+      // a single cell
+      action.x1 = action.x0;
+      action.y1 = action.y0;
+      action.radius = 0;
+      action.shape = Brush::Shape::kCircle;
+    } else {
+      action.x1 = readCoordinate(recording.width);
+      action.y1 = readCoordinate(recording.height);
+      action.radius = ReadByte(file, filename);
+      action.shape = static_cast<Brush::Shape>(ReadByte(file, filename));
+    }
+    action.element = static_cast<Cell::Element>(ReadByte(file, filename));
+    if (action.radius > Brush::kMaxRadius || action.shape > Brush::Shape::kSquare ||
+        action.element >= Cell::Element::kCount) {
+      throw std::runtime_error("Invalid action in recording: " + filename);
+    }
+    recording.actions.push_back(action);
+  }
+  return recording;
+}
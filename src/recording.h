@@ -0,0 +1,54 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_RECORDING_H_
+#define RAYLIB_SAND_SIM_SRC_RECORDING_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "automata_matrix.h"
+#include "brush.h"
+
+// Everything needed to play a session back tick for tick: the world settings, the seed and
+// every brush stroke, stamped with the tick it was painted before.
+//
+// On disk (little endian): "SSRC", u16 version, u64 seed, i32 width, i32 height, u8 update mode,
+// u64 tick count, u64 action count, then per action varint tick delta, varint x0, y0, x1 and y1,
+// u8 brush radius, u8 brush shape and u8 element. Version 1 recordings, which held a single cell
+// (varint x, varint y, u8 element) per action, still load.
+class Recording {
+ public:
+  static constexpr uint16_t kVersion = 2;
+
+  // The brush swept from (x0, y0) to (x1, y1).
+  struct Action {
+    uint64_t tick;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+    int radius;
+    Brush::Shape shape;
+    Cell::Element element;
+  };
+
+  inline void Record(const uint64_t tick, const Brush& brush, const int x0, const int y0, const int x1, const int y1,
+                     const Cell::Element element) {
+    actions.push_back({tick, x0, y0, x1, y1, brush.GetRadius(), brush.GetShape(), element});
+  }
+
+  void Save(const std::string& filename) const;
+  static Recording Load(const std::string& filename);
+
+  uint64_t seed = 0;
+  int width = 0;
+  int height = 0;
+  AutomataMatrixBase::UpdateMode updateMode = AutomataMatrixBase::UpdateMode::kSequential;
+  uint64_t tickCount = 0; // ticks the session ran for
+  std::vector<Action> actions;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_RECORDING_H_
@@ -0,0 +1,259 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "simulation_thread.h"
+
+#include <raylib.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <utility>
+
+namespace {
+
+void CopyPopulation(const AutomataMatrix& world, WorldFrame& frame) {
+  for (size_t element = 0; element < frame.population.size(); element++) {
+    frame.population[element] = world.GetPopulation(static_cast<Cell::Element>(element));
+  }
+  frame.chunkPopulation.resize(world.GetChunkCount() * element_tables::kCount);
+  for (int chunk = 0; chunk < world.GetChunkCount(); chunk++) {
+    for (size_t element = 0; element < element_tables::kCount; element++) {
+      frame.chunkPopulation[chunk * element_tables::kCount + element] =
+          world.GetChunkPopulation(chunk, static_cast<Cell::Element>(element));
+    }
+  }
+}
+
+// Everything the world holds, for all three slots to start from.
+WorldFrame CaptureFrame(const AutomataMatrix& world) {
+  WorldFrame frame;
+  frame.width = world.GetWidth();
+  frame.height = world.GetHeight();
+  frame.tick = world.GetTick();
+  frame.elements.resize(static_cast<size_t>(frame.width) * frame.height);
+  frame.shades.resize(frame.elements.size());
+  std::vector<Cell::Element> scratch(frame.width);
+  std::vector<uint8_t> shadeScratch(frame.width);
+  for (int y = 0; y < frame.height; y++) {
+    const Cell::Element* row = world.ReadElements(0, y, frame.width, scratch.data());
+    std::copy_n(row, frame.width, &frame.elements[static_cast<size_t>(y) * frame.width]);
+    const uint8_t* shades = world.ReadShades(0, y, frame.width, shadeScratch.data());
+    std::copy_n(shades, frame.width, &frame.shades[static_cast<size_t>(y) * frame.width]);
+  }
+  CopyPopulation(world, frame);
+  return frame;
+}
+
+} // namespace
+
+SimulationThread::SimulationThread(AutomataMatrix& world, Recording* recording, std::string snapshotPath,
+                                   const int maxTicksPerFrame)
+    : world(world),
+      recording(recording),
+      snapshotPath(std::move(snapshotPath)),
+      scheduler(1.0 / kTicksPerSecond, maxTicksPerFrame),
+      chunksX((world.GetWidth() + AutomataMatrix::kChunkSize - 1) / AutomataMatrix::kChunkSize),
+      frames(CaptureFrame(world)) {
+  const int chunksY = (world.GetHeight() + AutomataMatrix::kChunkSize - 1) / AutomataMatrix::kChunkSize;
+  for (std::vector<AutomataMatrix::DirtyRect>& slot : stale) {
+    slot.resize(chunksX * chunksY);
+  }
+  unseen.resize(chunksX * chunksY);
+  rowScratch.resize(world.GetWidth());
+  shadeScratch.resize(world.GetWidth());
+
+  // every slot already holds the world as it is now
+  world.TakeChangedRegions(changed);
+  changed.clear();
+
+  thread = std::thread([this] { Run(); });
+}
+
+SimulationThread::~SimulationThread() {
+  stopping.store(true, std::memory_order_release);
+  thread.join();
+  try {
+    snapshotWriter.Wait();
+  } catch (const std::exception& e) {
+    TraceLog(LOG_ERROR, "%s", e.what());
+  }
+}
+
+void SimulationThread::SetBrush(const BrushState& state) {
+  // a lifted brush doesn't care where it is
+  if (state == sentBrush || (!state.down && !sentBrush.down)) {
+    return;
+  }
+  // when the queue is full the brush is sent again next frame
+  if (commands.Push({Command::Kind::kBrush, state})) {
+    sentBrush = state;
+  }
+}
+
+void SimulationThread::SaveSnapshot() {
+  if (!commands.Push(Command{Command::Kind::kSaveSnapshot, {}})) {
+    TraceLog(LOG_WARNING, "Simulation is busy, snapshot not saved");
+  }
+}
+
+void SimulationThread::LoadSnapshot() {
+  // a recording only holds painting actions, so loading a snapshot would break it
+  if (recording != nullptr) {
+    TraceLog(LOG_WARNING, "Snapshots can't be loaded while recording");
+    return;
+  }
+  if (!commands.Push(Command{Command::Kind::kLoadSnapshot, {}})) {
+    TraceLog(LOG_WARNING, "Simulation is busy, snapshot not loaded");
+  }
+}
+
+void SimulationThread::Run() {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point previous = Clock::now();
+  while (!stopping.load(std::memory_order_acquire)) {
+    RunCommands();
+
+    const Clock::time_point now = Clock::now();
+    const double elapsed = std::chrono::duration<double>(now - previous).count();
+    previous = now;
+    int ticks = 0;
+    if (running.load(std::memory_order_relaxed)) {
+      ticks = scheduler.Advance(elapsed);
+    } else {
+      scheduler.Reset();
+    }
+
+    for (int i = 0; i < ticks; i++) {
+      Paint();
+      try {
+        world.Update();
+      } catch (const std::exception& e) {
+        // only population checking throws; say so once rather than every tick
+        TraceLog(LOG_ERROR, "%s", e.what());
+        world.SetVerifyPopulation(false);
+      }
+    }
+    // even without a tick a snapshot may have been loaded
+    PublishFrame(ticks, std::chrono::duration<double, std::milli>(Clock::now() - now).count());
+
+    // sleep until the next tick is due
+    const double wait = (1.0 - scheduler.GetAlpha()) * scheduler.GetStepSeconds();
+    std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+  }
+}
+
+void SimulationThread::RunCommands() {
+  Command command;
+  while (commands.Pop(command)) {
+    switch (command.kind) {
+      case Command::Kind::kBrush:
+        brushState = command.brush;
+        break;
+      case Command::Kind::kSaveSnapshot:
+        try {
+          snapshotWriter.Save(world, snapshotPath);
+          TraceLog(LOG_INFO, "Saving snapshot to %s (captured in %.2f ms)", snapshotPath.c_str(),
+                   snapshotWriter.GetCaptureMs());
+        } catch (const std::exception& e) {
+          TraceLog(LOG_ERROR, "%s", e.what());
+        }
+        break;
+      case Command::Kind::kLoadSnapshot:
+        try {
+          snapshotWriter.Wait();
+          Snapshot::Load(snapshotPath, world);
+        } catch (const std::exception& e) {
+          TraceLog(LOG_ERROR, "%s", e.what());
+        }
+        break;
+    }
+  }
+}
+
+// Paints the stroke since the last tick, keeping a note of it for the recording.
+void SimulationThread::Paint() {
+  if (!brushState.down) {
+    stroking = false;
+    return;
+  }
+  if (!stroking) {
+    strokeX = brushState.x;
+    strokeY = brushState.y;
+    stroking = true;
+  }
+  if (brush.GetRadius() != brushState.radius || brush.GetShape() != brushState.shape) {
+    brush.SetRadius(brushState.radius);
+    brush.SetShape(brushState.shape);
+  }
+  brush.Stroke(world, strokeX, strokeY, brushState.x, brushState.y, brushState.element);
+  if (recording != nullptr) {
+    recording->Record(world.GetTick(), brush, strokeX, strokeY, brushState.x, brushState.y, brushState.element);
+  }
+  strokeX = brushState.x;
+  strokeY = brushState.y;
+}
+
+void SimulationThread::PublishFrame(const int ticks, const double simulationMs) {
+  changed.clear();
+  world.TakeChangedRegions(changed);
+  if (ticks == 0 && changed.empty()) {
+    return;
+  }
+
+  // bring the back slot up to date: what it missed while the other slots were being filled, and
+  // what changed since
+  const int backIndex = frames.GetBackIndex();
+  for (const AutomataMatrix::DirtyRect& region : changed) {
+    const int chunk = GetChunkIndex(region);
+    for (int slot = 0; slot < 3; slot++) {
+      stale[slot][chunk].Include(region);
+    }
+    unseen[chunk].Include(region);
+  }
+  WorldFrame& frame = frames.GetBack();
+  frame.changedRegions.clear();
+  for (size_t chunk = 0; chunk < unseen.size(); chunk++) {
+    AutomataMatrix::DirtyRect& missing = stale[backIndex][chunk];
+    if (!missing.Empty()) {
+      CopyRegion(frame, missing);
+      missing = AutomataMatrix::DirtyRect{};
+    }
+    if (!unseen[chunk].Empty()) {
+      frame.changedRegions.push_back(unseen[chunk]);
+    }
+  }
+  frame.tick = world.GetTick();
+  frame.simulationMs = unseenMs + simulationMs;
+  frame.droppedTicks = scheduler.GetDroppedSteps();
+  CopyPopulation(world, frame);
+
+  // If the renderer took the previous frame it has everything up to there, otherwise it still
+  // needs whatever that one carried, which is all in this one.
+  if (frames.Publish()) {
+    unseenMs = frame.simulationMs;
+  } else {
+    unseenMs = simulationMs;
+    std::ranges::fill(unseen, AutomataMatrix::DirtyRect{});
+    for (const AutomataMatrix::DirtyRect& region : changed) {
+      unseen[GetChunkIndex(region)].Include(region);
+    }
+  }
+}
+
+void SimulationThread::CopyRegion(WorldFrame& frame, const AutomataMatrix::DirtyRect& region) {
+  const int width = region.Width();
+  for (int y = region.minY; y <= region.maxY; y++) {
+    const Cell::Element* row = world.ReadElements(region.minX, y, width, rowScratch.data());
+    std::copy_n(row, width, &frame.elements[static_cast<size_t>(y) * frame.width + region.minX]);
+    const uint8_t* shades = world.ReadShades(region.minX, y, width, shadeScratch.data());
+    std::copy_n(shades, width, &frame.shades[static_cast<size_t>(y) * frame.width + region.minX]);
+  }
+}
+
+int SimulationThread::GetChunkIndex(const AutomataMatrix::DirtyRect& region) const {
+  // regions can overshoot their chunk by a cell, so go by the middle
+  const int x = (region.minX + region.maxX) / 2;
+  const int y = (region.minY + region.maxY) / 2;
+  return (y / AutomataMatrix::kChunkSize) * chunksX + x / AutomataMatrix::kChunkSize;
+}
@@ -0,0 +1,131 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_SIMULATION_THREAD_H_
+#define RAYLIB_SAND_SIM_SRC_SIMULATION_THREAD_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "automata_matrix.h"
+#include "brush.h"
+#include "fixed_step_scheduler.h"
+#include "recording.h"
+#include "snapshot.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
+// A copy of the world's elements and shades as they were after a tick, for the renderer.
+struct WorldFrame {
+  int width = 0;
+  int height = 0;
+  uint64_t tick = 0;
+  std::vector<Cell::Element> elements; // row by row
+  std::vector<uint8_t> shades;         // likewise
+  // Per chunk, every cell changed since the frame the renderer took before this one.
+  std::vector<AutomataMatrix::DirtyRect> changedRegions;
+  double simulationMs = 0.0;   // spent ticking since that frame
+  uint64_t droppedTicks = 0;   // ticks dropped by the scheduler so far
+  // Cells of each element, in the world and per chunk (element_tables::kCount per chunk).
+  std::array<int64_t, element_tables::kCount> population{};
+  std::vector<int> chunkPopulation;
+};
+
+// Runs the world on a thread of its own at a fixed tick rate, so a slow tick never holds up
+// drawing and waiting for vsync never holds up the simulation. Finished ticks are published to
+// the renderer through a triple buffer of element grids; painting and snapshot requests go the
+// other way through a queue. Once started, the world belongs to this thread until it is
+// destroyed.
+class SimulationThread {
+ public:
+  static constexpr int kTicksPerSecond = 60;
+
+  // recording may be null. maxTicksPerFrame caps how many ticks one wake-up may run to catch up.
+  SimulationThread(AutomataMatrix& world, Recording* recording, std::string snapshotPath, int maxTicksPerFrame);
+  ~SimulationThread();
+
+  SimulationThread(const SimulationThread&) = delete;
+  SimulationThread& operator=(const SimulationThread&) = delete;
+
+  // Ticks only while running; time spent stopped isn't made up afterwards.
+  inline void SetRunning(const bool value) { running.store(value, std::memory_order_relaxed); }
+
+  // What the mouse is painting with, and where.
+  struct BrushState {
+    int x = 0;
+    int y = 0;
+    Cell::Element element = Cell::Element::kAir;
+    bool down = false;
+    int radius = 0;
+    Brush::Shape shape = Brush::Shape::kCircle;
+
+    bool operator==(const BrushState&) const = default;
+  };
+
+  // While the brush is down, each tick first paints a stroke from where it was at the previous
+  // tick to where it is now. Unchanged brushes aren't sent again.
+  void SetBrush(const BrushState& state);
+
+  // Saved or loaded between ticks. Loading is refused while recording.
+  void SaveSnapshot();
+  void LoadSnapshot();
+
+  // Renderer side: moves on to the latest published frame, false if there isn't a new one.
+  inline bool AcquireFrame() { return frames.Acquire(); }
+  [[nodiscard]] inline const WorldFrame& GetFrame() const { return frames.GetFront(); }
+
+ private:
+  struct Command {
+    enum class Kind : uint8_t {
+      kBrush,
+      kSaveSnapshot,
+      kLoadSnapshot,
+    };
+
+    Kind kind = Kind::kBrush;
+    BrushState brush;
+  };
+
+  void Run();
+  void RunCommands();
+  void Paint();
+  void PublishFrame(int ticks, double simulationMs);
+  void CopyRegion(WorldFrame& frame, const AutomataMatrix::DirtyRect& region);
+  [[nodiscard]] int GetChunkIndex(const AutomataMatrix::DirtyRect& region) const;
+
+  AutomataMatrix& world;
+  Recording* recording;
+  std::string snapshotPath;
+  SnapshotWriter snapshotWriter;
+  FixedStepScheduler scheduler;
+  int chunksX;
+
+  // simulation thread only
+  BrushState brushState;
+  Brush brush;
+  bool stroking = false; // the brush was down at the previous tick, at (strokeX, strokeY)
+  int strokeX = 0;
+  int strokeY = 0;
+  std::vector<AutomataMatrix::DirtyRect> changed;
+  std::array<std::vector<AutomataMatrix::DirtyRect>, 3> stale; // per slot and chunk, cells it lacks
+  std::vector<AutomataMatrix::DirtyRect> unseen; // per chunk, changes the renderer may not have
+  double unseenMs = 0.0;
+  std::vector<Cell::Element> rowScratch;
+  std::vector<uint8_t> shadeScratch;
+
+  // main thread only
+  BrushState sentBrush;
+
+  TripleBuffer<WorldFrame> frames;
+  SpscQueue<Command, 256> commands;
+  std::atomic<bool> running{false};
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_SIMULATION_THREAD_H_
@@ -0,0 +1,305 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'S', 'N', 'P'};
+constexpr int kChunkSize = AutomataMatrixBase::kChunkSize;
+constexpr size_t kFlushBytes = 1 << 16;
+
+// Cells of one chunk, clipped to the world.
+struct ChunkRect {
+  int x0;
+  int y0;
+  int x1; // exclusive
+  int y1; // exclusive
+
+  [[nodiscard]] size_t Count() const { return static_cast<size_t>(x1 - x0) * (y1 - y0); }
+};
+
+int ChunksX(const int width) {
+  return (width + kChunkSize - 1) / kChunkSize;
+}
+
+int ChunksY(const int height) {
+  return (height + kChunkSize - 1) / kChunkSize;
+}
+
+ChunkRect GetChunkRect(const int index, const int width, const int height) {
+  const int cx = index % ChunksX(width);
+  const int cy = index / ChunksX(width);
+  return {cx * kChunkSize, cy * kChunkSize,
+          std::min((cx + 1) * kChunkSize, width), std::min((cy + 1) * kChunkSize, height)};
+}
+
+template <typename T>
+void AppendInt(std::vector<uint8_t>& out, const T value) {
+  for (size_t i = 0; i < sizeof(T); i++) {
+    out.push_back(static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+  }
+}
+
+void AppendVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void AppendRuns(std::vector<uint8_t>& out, const uint8_t* data, const size_t count) {
+  for (size_t i = 0; i < count;) {
+    const uint8_t value = data[i];
+    size_t end = i + 1;
+    while (end < count && data[end] == value) {
+      end++;
+    }
+    AppendVarint(out, end - i);
+    out.push_back(value);
+    i = end;
+  }
+}
+
+// Bounds checked reads from a file loaded into memory.
+class ByteReader {
+ public:
+  ByteReader(const std::vector<uint8_t>& data, const std::string& filename) : data(data), filename(filename) {}
+
+  uint8_t Byte() {
+    if (pos == data.size()) {
+      throw std::runtime_error("Unexpected end of snapshot: " + filename);
+    }
+    return data[pos++];
+  }
+
+  template <typename T>
+  T Int() {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      value |= static_cast<uint64_t>(Byte()) << (8 * i);
+    }
+    return static_cast<T>(value);
+  }
+
+  uint64_t Varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const uint8_t byte = Byte();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw Corrupt();
+  }
+
+  void Runs(uint8_t* out, const size_t count, const unsigned limit) {
+    for (size_t filled = 0; filled < count;) {
+      const uint64_t run = Varint();
+      const uint8_t value = Byte();
+      if (run == 0 || run > count - filled || value >= limit) {
+        throw Corrupt();
+      }
+      std::memset(out + filled, value, run);
+      filled += run;
+    }
+  }
+
+  [[nodiscard]] std::runtime_error Corrupt() const {
+    return std::runtime_error("Corrupt snapshot: " + filename);
+  }
+
+ private:
+  const std::vector<uint8_t>& data;
+  const std::string& filename;
+  size_t pos = 0;
+};
+
+} // namespace
+
+template <typename Layout>
+void Snapshot::Capture(const BasicAutomataMatrix<Layout>& world) {
+  width = world.GetWidth();
+  height = world.GetHeight();
+  tick = world.GetTick();
+  seed = world.GetSeed();
+  raw.resize(static_cast<size_t>(width) * height * Layout::kBytesPerCell);
+  world.CopyCellsTo(raw.data());
+  unpackCells = &UnpackCells<Layout>;
+}
+
+void Snapshot::Unpack() {
+  if (unpackCells) {
+    unpackCells(*this);
+    unpackCells = nullptr;
+  }
+}
+
+template <typename Layout>
+void Snapshot::UnpackCells(Snapshot& snapshot) {
+  const int width = snapshot.width;
+  const int height = snapshot.height;
+  Layout cells(width * height);
+  cells.CopyFrom(snapshot.raw.data());
+
+  snapshot.chunkIndices.clear();
+  snapshot.chunkOffsets.clear();
+  // room for every chunk, so after the first unpack this never allocates
+  snapshot.planes.resize(static_cast<size_t>(width) * height * 3);
+
+  size_t offset = 0;
+  for (int index = 0; index < ChunksX(width) * ChunksY(height); index++) {
+    const ChunkRect rect = GetChunkRect(index, width, height);
+    const size_t count = rect.Count();
+    uint8_t* elements = &snapshot.planes[offset];
+    uint8_t* heats = elements + count;
+    uint8_t* shades = heats + count;
+
+    // air is element 0, so a chunk of plain air ORs to nothing
+    uint8_t used = 0;
+    size_t i = 0;
+    for (int y = rect.y0; y < rect.y1; y++) {
+      for (int pos = y*width + rect.x0; pos < y*width + rect.x1; pos++, i++) {
+        elements[i] = static_cast<uint8_t>(cells.GetElement(pos));
+        heats[i] = cells.GetHeat(pos);
+        shades[i] = cells.GetShade(pos);
+        used |= elements[i] | heats[i] | shades[i];
+      }
+    }
+    if (used) {
+      snapshot.chunkIndices.push_back(index);
+      snapshot.chunkOffsets.push_back(offset);
+      offset += 3 * count;
+    }
+  }
+}
+
+void Snapshot::Write(std::ostream& out) {
+  Unpack();
+
+  std::vector<uint8_t> buffer;
+  buffer.reserve(kFlushBytes + 4 * kChunkSize * kChunkSize);
+  buffer.insert(buffer.end(), kMagic, kMagic + sizeof(kMagic));
+  AppendInt<uint16_t>(buffer, kVersion);
+  AppendInt<int32_t>(buffer, width);
+  AppendInt<int32_t>(buffer, height);
+  AppendInt<uint64_t>(buffer, tick);
+  AppendInt<uint64_t>(buffer, seed);
+  AppendInt<uint32_t>(buffer, static_cast<uint32_t>(chunkIndices.size()));
+
+  for (size_t chunk = 0; chunk < chunkIndices.size(); chunk++) {
+    const size_t count = GetChunkRect(chunkIndices[chunk], width, height).Count();
+    const uint8_t* data = &planes[chunkOffsets[chunk]];
+    AppendVarint(buffer, chunkIndices[chunk]);
+    for (int plane = 0; plane < 3; plane++) {
+      AppendRuns(buffer, data + plane * count, count);
+    }
+    if (buffer.size() >= kFlushBytes) {
+      out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+      buffer.clear();
+    }
+  }
+  out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+}
+
+void Snapshot::Save(const std::string& filename) {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+  Write(file);
+  if (!file.good()) {
+    throw std::runtime_error("Failed to write snapshot: " + filename);
+  }
+}
+
+template <typename Layout>
+void Snapshot::Load(const std::string& filename, BasicAutomataMatrix<Layout>& world) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open file: " + filename);
+  }
+  const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  // decode everything before touching the world, so a bad file leaves it as it was
+  ByteReader reader(data, filename);
+  char magic[sizeof(kMagic)];
+  for (char& c : magic) {
+    c = static_cast<char>(reader.Byte());
+  }
+  if (!std::equal(magic, magic + sizeof(magic), kMagic)) {
+    throw std::runtime_error("Not a snapshot: " + filename);
+  }
+  if (reader.Int<uint16_t>() != kVersion) {
+    throw std::runtime_error("Unsupported snapshot version: " + filename);
+  }
+
+  Snapshot snapshot;
+  snapshot.width = reader.Int<int32_t>();
+  snapshot.height = reader.Int<int32_t>();
+  snapshot.tick = reader.Int<uint64_t>();
+  snapshot.seed = reader.Int<uint64_t>();
+  if (snapshot.width != world.GetWidth() || snapshot.height != world.GetHeight()) {
+    throw std::runtime_error("Snapshot is for a " + std::to_string(snapshot.width) + "x" +
+                             std::to_string(snapshot.height) + " world: " + filename);
+  }
+
+  const int chunkCount = ChunksX(snapshot.width) * ChunksY(snapshot.height);
+  const auto savedChunks = reader.Int<uint32_t>();
+  if (savedChunks > static_cast<uint32_t>(chunkCount)) {
+    throw reader.Corrupt();
+  }
+  snapshot.planes.resize(static_cast<size_t>(savedChunks) * 3 * kChunkSize * kChunkSize);
+  size_t offset = 0;
+  for (uint32_t chunk = 0; chunk < savedChunks; chunk++) {
+    const uint64_t index = reader.Varint();
+    if (index >= static_cast<uint64_t>(chunkCount)) {
+      throw reader.Corrupt();
+    }
+    const size_t count = GetChunkRect(static_cast<int>(index), snapshot.width, snapshot.height).Count();
+    reader.Runs(&snapshot.planes[offset], count, static_cast<unsigned>(Cell::Element::kCount));
+    reader.Runs(&snapshot.planes[offset + count], count, 256);
+    reader.Runs(&snapshot.planes[offset + 2 * count], count, Cell::kShadeCount);
+    snapshot.chunkIndices.push_back(static_cast<int>(index));
+    snapshot.chunkOffsets.push_back(offset);
+    offset += 3 * count;
+  }
+
+  std::vector<const uint8_t*> chunkData(chunkCount, nullptr);
+  for (size_t chunk = 0; chunk < snapshot.chunkIndices.size(); chunk++) {
+    chunkData[snapshot.chunkIndices[chunk]] = &snapshot.planes[snapshot.chunkOffsets[chunk]];
+  }
+  for (int index = 0; index < chunkCount; index++) {
+    const ChunkRect rect = GetChunkRect(index, snapshot.width, snapshot.height);
+    const size_t count = rect.Count();
+    const uint8_t* elements = chunkData[index];
+    size_t i = 0;
+    for (int y = rect.y0; y < rect.y1; y++) {
+      for (int pos = y*snapshot.width + rect.x0; pos < y*snapshot.width + rect.x1; pos++, i++) {
+        if (elements) {
+          world.SetCellState(pos, static_cast<Cell::Element>(elements[i]), elements[count + i], elements[2 * count + i]);
+        } else {
+          world.SetCellState(pos, Cell::Element::kAir, 0, 0);
+        }
+      }
+    }
+  }
+  world.WakeAll();
+  world.SetTick(snapshot.tick);
+  world.SetSeed(snapshot.seed);
+}
+
+template void Snapshot::Capture(const BasicAutomataMatrix<SoaCellLayout>&);
+template void Snapshot::Capture(const BasicAutomataMatrix<AosCellLayout>&);
+template void Snapshot::Capture(const BasicAutomataMatrix<PackedCellLayout>&);
+template void Snapshot::Load(const std::string&, BasicAutomataMatrix<SoaCellLayout>&);
+template void Snapshot::Load(const std::string&, BasicAutomataMatrix<AosCellLayout>&);
+template void Snapshot::Load(const std::string&, BasicAutomataMatrix<PackedCellLayout>&);
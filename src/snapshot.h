@@ -0,0 +1,103 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_SNAPSHOT_H_
+#define RAYLIB_SAND_SIM_SRC_SNAPSHOT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "automata_matrix.h"
+
+// A copy of a world's cells (element, heat and shade) taken between ticks.
+//
+// On disk (little endian): "SSNP", u16 version, i32 width, i32 height, u64 tick, u64 seed,
+// u32 chunk count, then for each chunk that is not plain air its varint index followed by its
+// element, heat and shade planes. Each plane is run-length encoded as (varint run, u8 value)
+// pairs over the chunk's cells row by row. Chunks left out are air with no heat or shade.
+class Snapshot {
+ public:
+  static constexpr uint16_t kVersion = 1;
+
+  // Copies the world's raw cell state in one go. Working out which chunks to keep is left to
+  // Unpack, so it can happen off the simulation thread.
+  template <typename Layout>
+  void Capture(const BasicAutomataMatrix<Layout>& world);
+
+  // Splits the captured cells into per-chunk planes, leaving out chunks of plain air. Write does
+  // this itself if it hasn't been done yet.
+  void Unpack();
+
+  // Encodes and writes a chunk at a time, so the whole file is never held in memory.
+  void Write(std::ostream& out);
+  void Save(const std::string& filename);
+
+  // Replaces the world's cells, tick and seed with the ones saved in filename. The world must be
+  // the size it was saved at.
+  template <typename Layout>
+  static void Load(const std::string& filename, BasicAutomataMatrix<Layout>& world);
+
+  // Chunks kept by the last Unpack.
+  [[nodiscard]] inline size_t GetChunkCount() const { return chunkIndices.size(); }
+
+ private:
+  template <typename Layout>
+  static void UnpackCells(Snapshot& snapshot);
+
+  int width = 0;
+  int height = 0;
+  uint64_t tick = 0;
+  uint64_t seed = 0;
+  std::vector<int> chunkIndices;
+  std::vector<size_t> chunkOffsets; // into planes, per chunk its elements, heats, then shades
+  std::vector<uint8_t> planes;
+  std::vector<uint8_t> raw;                  // as captured, in the world's layout
+  void (*unpackCells)(Snapshot&) = nullptr;  // set until the capture is unpacked
+};
+
+// Saves snapshots on a background thread so the simulation can carry on while the file is
+// written. Only the capture, a copy of the cells, happens on the calling thread.
+class SnapshotWriter {
+ public:
+  ~SnapshotWriter() {
+    if (pending.valid()) {
+      pending.wait();
+    }
+  }
+
+  // Waits for the previous save, captures the world and starts writing it to filename.
+  template <typename Layout>
+  void Save(const BasicAutomataMatrix<Layout>& world, const std::string& filename) {
+    Wait();
+    const auto start = std::chrono::steady_clock::now();
+    snapshot.Capture(world);
+    captureMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    pending = std::async(std::launch::async, [this, filename] { snapshot.Save(filename); });
+  }
+
+  // Blocks until the save in flight is on disk, and rethrows anything it failed with.
+  void Wait() {
+    if (pending.valid()) {
+      pending.get();
+    }
+  }
+
+  [[nodiscard]] inline bool IsBusy() const {
+    return pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  }
+
+  // How long the last Save held up its caller.
+  [[nodiscard]] inline double GetCaptureMs() const { return captureMs; }
+
+ private:
+  Snapshot snapshot;
+  std::future<void> pending;
+  double captureMs = 0.0;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_SNAPSHOT_H_
@@ -0,0 +1,348 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "sparse_world.h"
+
+#include <algorithm>
+#include <chrono>
+
+Cell::Element SparseWorld::GetCell(const int64_t x, const int64_t y) {
+  const CellRef ref = Locate(x, y);
+  return ref.chunk ? ref.chunk->cells.GetElement(ref.index) : Cell::Element::kAir;
+}
+
+void SparseWorld::SetCell(const int64_t x, const int64_t y, const Cell::Element element) {
+  CellRef ref = Locate(x, y);
+  if (!ref.chunk) {
+    // writing air into empty space changes nothing
+    if (element == Cell::Element::kAir) {
+      return;
+    }
+    ref.chunk = &AllocateChunk(CoordOf(x, y));
+  }
+  const Cell::Element previous = ref.chunk->cells.GetElement(ref.index);
+  ref.chunk->population += (element != Cell::Element::kAir) - (previous != Cell::Element::kAir);
+  ref.chunk->cells.SetElement(ref.index, element);
+  WakeCell(ref);
+}
+
+size_t SparseWorld::GetChunkMemory() const {
+  return chunks.size() * sizeof(Chunk) + GetResidentChunkCount() * kChunkSize * kChunkSize * Layout::kBytesPerCell;
+}
+
+void SparseWorld::EnablePaging(const std::string& filename, const uint64_t idleTicks) {
+  store = std::make_unique<ChunkStore>(filename, kChunkSize * kChunkSize * Layout::kBytesPerCell);
+  this->idleTicks = idleTicks;
+}
+
+void SparseWorld::Prefetch(const int64_t x0, const int64_t y0, const int64_t x1, const int64_t y1) {
+  const ChunkCoord first = CoordOf(x0, y0);
+  const ChunkCoord last = CoordOf(x1, y1);
+  for (int64_t cy = first.y; cy <= last.y; cy++) {
+    for (int64_t cx = first.x; cx <= last.x; cx++) {
+      if (Chunk* chunk = FindChunk({cx, cy})) {
+        chunk->lastUsed = tick;
+      }
+    }
+  }
+}
+
+uint64_t SparseWorld::HashCells() const {
+  std::vector<const Chunk*> sorted;
+  sorted.reserve(chunks.size());
+  for (const auto& [coord, chunk] : chunks) {
+    sorted.push_back(chunk.get());
+  }
+  std::ranges::sort(sorted, [](const Chunk* a, const Chunk* b) {
+    return a->coord.y != b->coord.y ? a->coord.y < b->coord.y : a->coord.x < b->coord.x;
+  });
+
+  uint64_t hash = 0xcbf29ce484222325ull;
+  const auto add = [&hash](const uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++) {
+      hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3ull;
+    }
+  };
+  Layout parked(kChunkSize * kChunkSize);
+  for (const Chunk* chunk : sorted) {
+    add(static_cast<uint64_t>(chunk->coord.x), 8);
+    add(static_cast<uint64_t>(chunk->coord.y), 8);
+    // evicted chunks are read straight from the store rather than paged in
+    const Layout* cells = &chunk->cells;
+    if (chunk->slot >= 0) {
+      parked.CopyFrom(store->GetSlot(chunk->slot));
+      cells = &parked;
+    }
+    for (int i = 0; i < kChunkSize * kChunkSize; i++) {
+      add(static_cast<uint64_t>(cells->GetElement(i)), 1);
+      add(cells->GetHeat(i), 1);
+      add(cells->GetShade(i), 1);
+    }
+  }
+  return hash;
+}
+
+SparseWorld::Chunk* SparseWorld::FindChunk(const ChunkCoord coord) {
+  Chunk* chunk = PeekChunk(coord);
+  if (chunk && chunk->slot >= 0) {
+    PageIn(*chunk);
+  }
+  return chunk;
+}
+
+SparseWorld::Chunk* SparseWorld::PeekChunk(const ChunkCoord coord) const {
+  const auto it = chunks.find(coord);
+  return it == chunks.end() ? nullptr : it->second.get();
+}
+
+SparseWorld::Chunk& SparseWorld::AllocateChunk(const ChunkCoord coord) {
+  // chunks are held by pointer, so the ones being updated stay put when the map grows
+  auto [it, inserted] = chunks.try_emplace(coord, nullptr);
+  if (inserted) {
+    it->second = std::make_unique<Chunk>(coord);
+    it->second->lastUsed = tick;
+  } else if (it->second->slot >= 0) {
+    PageIn(*it->second);
+  }
+  return *it->second;
+}
+
+void SparseWorld::PageIn(Chunk& chunk) {
+  const auto start = std::chrono::steady_clock::now();
+  chunk.cells = Layout(kChunkSize * kChunkSize);
+  chunk.cells.CopyFrom(store->GetSlot(chunk.slot));
+  store->Release(chunk.slot);
+  chunk.slot = -1;
+  chunk.lastUsed = tick;
+  evictedChunks--;
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  pagingStats.pageIns++;
+  pagingStats.pageInNs += ns;
+  pagingStats.maxPageInNs = std::max(pagingStats.maxPageInNs, ns);
+}
+
+void SparseWorld::PageOut(Chunk& chunk) {
+  const auto start = std::chrono::steady_clock::now();
+  // generations only matter within a tick, and paging happens between or at the start of one
+  chunk.cells.ClearUpdated();
+  chunk.slot = store->Allocate();
+  chunk.cells.CopyTo(store->GetSlot(chunk.slot));
+  store->Evict(chunk.slot);
+  chunk.cells = Layout(0);
+  evictedChunks++;
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  pagingStats.pageOuts++;
+  pagingStats.pageOutNs += ns;
+  pagingStats.maxPageOutNs = std::max(pagingStats.maxPageOutNs, ns);
+}
+
+void SparseWorld::EvictIdleChunks() {
+  for (auto& [coord, chunk] : chunks) {
+    if (chunk->slot < 0 && chunk->current.Empty() && tick - chunk->lastUsed >= idleTicks) {
+      PageOut(*chunk);
+    }
+  }
+}
+
+SparseWorld::CellRef SparseWorld::Locate(const int64_t x, const int64_t y) {
+  return {x, y, FindChunk(CoordOf(x, y)), static_cast<int>((y & kChunkMask) * kChunkSize + (x & kChunkMask))};
+}
+
+SparseWorld::CellRef SparseWorld::Offset(const CellRef& ref, const int dx, const int dy) {
+  const int x = (ref.index & kChunkMask) + dx;
+  const int y = (ref.index >> kChunkShift) + dy;
+  if (ref.chunk && x >= 0 && x < kChunkSize && y >= 0 && y < kChunkSize) {
+    return {ref.x + dx, ref.y + dy, ref.chunk, y * kChunkSize + x};
+  }
+  return Locate(ref.x + dx, ref.y + dy);
+}
+
+void SparseWorld::SwapCells(const CellRef& from, CellRef& to) {
+  if (!to.chunk) {
+    to.chunk = &AllocateChunk(CoordOf(to.x, to.y));
+  }
+
+  if (from.chunk == to.chunk) {
+    from.chunk->cells.Swap(from.index, to.index);
+  } else {
+    Layout& a = from.chunk->cells;
+    Layout& b = to.chunk->cells;
+    const Cell::Element elementA = a.GetElement(from.index);
+    const Cell::Element elementB = b.GetElement(to.index);
+    const uint8_t heatA = a.GetHeat(from.index);
+    const uint8_t shadeA = a.GetShade(from.index);
+    const uint8_t updatedA = a.GetUpdated(from.index);
+    a.SetElement(from.index, elementB);
+    a.SetHeat(from.index, b.GetHeat(to.index));
+    a.SetShade(from.index, b.GetShade(to.index));
+    a.SetUpdated(from.index, b.GetUpdated(to.index));
+    b.SetElement(to.index, elementA);
+    b.SetHeat(to.index, heatA);
+    b.SetShade(to.index, shadeA);
+    b.SetUpdated(to.index, updatedA);
+
+    const int filledA = elementA != Cell::Element::kAir;
+    const int filledB = elementB != Cell::Element::kAir;
+    from.chunk->population += filledB - filledA;
+    to.chunk->population += filledA - filledB;
+  }
+
+  WakeCell(from);
+  WakeCell(to);
+}
+
+// Same as AutomataMatrixBase::WakeCell, except that unallocated chunks are all air and have
+// nothing to wake. Evicted chunks are paged in once the tick is over.
+void SparseWorld::WakeCell(const CellRef& ref) {
+  const int x = ref.index & kChunkMask;
+  const int y = ref.index >> kChunkShift;
+  if (x > 0 && x < kChunkSize - 1 && y > 0 && y < kChunkSize - 1) {
+    WakeRect(*ref.chunk, x - 1, y - 1, x + 1, y + 1);
+    return;
+  }
+
+  const ChunkCoord first = CoordOf(ref.x - 1, ref.y - 1);
+  const ChunkCoord last = CoordOf(ref.x + 1, ref.y + 1);
+  for (int64_t cy = first.y; cy <= last.y; cy++) {
+    for (int64_t cx = first.x; cx <= last.x; cx++) {
+      Chunk* chunk = PeekChunk({cx, cy});
+      if (!chunk) {
+        continue;
+      }
+      const int64_t originX = cx * kChunkSize;
+      const int64_t originY = cy * kChunkSize;
+      WakeRect(*chunk,
+               static_cast<int>(std::max<int64_t>(ref.x - 1 - originX, 0)),
+               static_cast<int>(std::max<int64_t>(ref.y - 1 - originY, 0)),
+               static_cast<int>(std::min<int64_t>(ref.x + 1 - originX, kChunkSize - 1)),
+               static_cast<int>(std::min<int64_t>(ref.y + 1 - originY, kChunkSize - 1)));
+    }
+  }
+}
+
+void SparseWorld::WakeRect(Chunk& chunk, const int x0, const int y0, const int x1, const int y1) {
+  chunk.next.Include(x0, y0, x1, y1);
+  chunk.lastUsed = tick;
+  if (!chunk.queued) {
+    chunk.queued = true;
+    nextAwake.push_back(&chunk);
+  }
+}
+
+void SparseWorld::ApplyGravity(CellRef ref, int weight, const int direction, const bool liquid) {
+  // a particle that has already moved into a cell still to be visited this tick stays put
+  if (ref.chunk->cells.GetUpdated(ref.index) == generation) {
+    return;
+  }
+  const int side = direction ? 1 : -1;
+  while (weight-- != 0) {
+    // neighbours are looked up one at a time, since crossing into another chunk costs a lookup
+    if (CellRef below = Offset(ref, 0, -1); IsEmpty(below)) {
+      SwapCells(ref, below);
+      ref = below;
+    } else if (CellRef directionA = Offset(ref, side, -1); IsEmpty(directionA)) {
+      SwapCells(ref, directionA);
+      ref = directionA;
+    } else if (CellRef directionB = Offset(ref, -side, -1); IsEmpty(directionB)) {
+      SwapCells(ref, directionB);
+      ref = directionB;
+    } else {
+      if (liquid) {
+        ApplySpread(ref, weight, direction);
+      }
+      break;
+    }
+  }
+  ref.chunk->cells.SetUpdated(ref.index, generation);
+}
+
+void SparseWorld::ApplySpread(CellRef& ref, int spread, const int direction) {
+  const int side = direction ? 1 : -1;
+  while (spread-- != 0) {
+    if (CellRef directionA = Offset(ref, side, 0); IsEmpty(directionA)) {
+      SwapCells(ref, directionA);
+      ref = directionA;
+    } else if (CellRef directionB = Offset(ref, -side, 0); IsEmpty(directionB)) {
+      SwapCells(ref, directionB);
+      ref = directionB;
+    }
+  }
+}
+
+void SparseWorld::UpdateCell(Chunk& chunk, const int index) {
+  const Cell::Element element = chunk.cells.GetElement(index);
+  const Cell::Type type = Cell::GetType(element);
+  if (type != Cell::Type::kPowder && type != Cell::Type::kLiquid) {
+    return;
+  }
+  const int64_t x = chunk.coord.x * kChunkSize + (index & kChunkMask);
+  const int64_t y = chunk.coord.y * kChunkSize + (index >> kChunkShift);
+  ApplyGravity({x, y, &chunk, index}, Cell::GetWeight(element), RandomBit(x, y), type == Cell::Type::kLiquid);
+}
+
+void SparseWorld::Update() {
+  tickKey = Random::Hash(seed, tick);
+  generation = static_cast<uint8_t>(tick % Layout::kGenerations + 1);
+
+  // like the dense sequential update: a row at a time bottom to top across each band of chunks
+  for (size_t band = 0; band < awake.size();) {
+    size_t bandEnd = band;
+    while (bandEnd < awake.size() && awake[bandEnd]->coord.y == awake[band]->coord.y) {
+      bandEnd++;
+    }
+    for (int y = 0; y < kChunkSize; y++) {
+      for (size_t i = band; i < bandEnd; i++) {
+        Chunk& chunk = *awake[i];
+        if (y < chunk.current.minY || y > chunk.current.maxY) {
+          continue;
+        }
+        for (int x = chunk.current.minX; x <= chunk.current.maxX; x++) {
+          UpdateCell(chunk, y * kChunkSize + x);
+        }
+      }
+    }
+    band = bandEnd;
+  }
+
+  FinishTick();
+  if (generation == Layout::kGenerations) {
+    for (auto& [coord, chunk] : chunks) {
+      chunk->cells.ClearUpdated();
+    }
+  }
+}
+
+void SparseWorld::FinishTick() {
+  for (Chunk* chunk : awake) {
+    chunk->current = DirtyRect{};
+  }
+  awake.clear();
+
+  // every chunk that changed this tick was woken, so this also finds the ones left all air
+  for (Chunk* chunk : nextAwake) {
+    chunk->queued = false;
+    if (chunk->population == 0) {
+      chunks.erase(chunk->coord);
+      continue;
+    }
+    if (chunk->slot >= 0) {
+      PageIn(*chunk);
+    }
+    chunk->current = chunk->next;
+    chunk->next = DirtyRect{};
+    awake.push_back(chunk);
+  }
+  nextAwake.clear();
+
+  std::ranges::sort(awake, [](const Chunk* a, const Chunk* b) {
+    return a->coord.y != b->coord.y ? a->coord.y < b->coord.y : a->coord.x < b->coord.x;
+  });
+  tick++;
+
+  if (store && tick % kEvictionInterval == 0) {
+    EvictIdleChunks();
+  }
+}
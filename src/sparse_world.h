@@ -0,0 +1,169 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_SPARSE_WORLD_H_
+#define RAYLIB_SAND_SIM_SRC_SPARSE_WORLD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "automata_matrix.h"
+#include "chunk_store.h"
+
+// An unbounded world addressed with 64-bit coordinates, for maps far too big to hold densely.
+// Cells live in square chunks that are only allocated once something other than air is written
+// to them and are freed again once they are all air, so empty space costs no memory. Everything
+// outside an allocated chunk is air and nothing stops a particle falling forever, so give the
+// world a floor.
+//
+// It runs the original step-by-step rules, sequentially bottom to top over the awake chunks:
+// every particle moves one cell at a time, with none of BasicAutomataMatrix's fast flow, column
+// fall or settled cell skipping. Heat and shade are carried with particles but never diffused
+// or picked; painted cells get shade 0. A run is reproducible from its seed. Coordinates must
+// stay within +-2^62.
+//
+// With paging enabled, chunks left idle for a while are copied into a memory-mapped ChunkStore
+// and their memory released. They come back when they are read or written, when activity
+// next to them wakes them, or when Prefetch asks for them, e.g. for the area in view.
+class SparseWorld {
+ public:
+  static constexpr int kChunkSize = AutomataMatrixBase::kChunkSize;
+  using Layout = AutomataMatrix::LayoutType;
+  using DirtyRect = AutomataMatrixBase::DirtyRect;
+
+  struct PagingStats {
+    uint64_t pageIns = 0;
+    uint64_t pageOuts = 0;
+    double pageInNs = 0.0;     // total
+    double maxPageInNs = 0.0;
+    double pageOutNs = 0.0;    // total
+    double maxPageOutNs = 0.0;
+  };
+
+  // Pages the chunk holding the cell back in if it was evicted.
+  [[nodiscard]] Cell::Element GetCell(int64_t x, int64_t y);
+  void SetCell(int64_t x, int64_t y, Cell::Element element);
+
+  void Update();
+
+  // Number of completed Update calls.
+  [[nodiscard]] inline uint64_t GetTick() const { return tick; }
+
+  inline void SetSeed(const uint64_t value) { seed = value; }
+  [[nodiscard]] inline uint64_t GetSeed() const { return seed; }
+
+  [[nodiscard]] inline size_t GetChunkCount() const { return chunks.size(); }
+  [[nodiscard]] inline size_t GetResidentChunkCount() const { return chunks.size() - evictedChunks; }
+  [[nodiscard]] inline int GetAwakeChunkCount() const { return static_cast<int>(awake.size()); }
+
+  // Bytes held in memory by the allocated chunks, not counting evicted cells.
+  [[nodiscard]] size_t GetChunkMemory() const;
+
+  // Evicts chunks to a file once they have gone idleTicks without being woken, touched or
+  // prefetched.
+  void EnablePaging(const std::string& filename, uint64_t idleTicks);
+  [[nodiscard]] inline const PagingStats& GetPagingStats() const { return pagingStats; }
+
+  // Pages in every allocated chunk overlapping the rectangle and keeps it resident a while.
+  void Prefetch(int64_t x0, int64_t y0, int64_t x1, int64_t y1);
+
+  // FNV-1a over every allocated chunk's position and cells, in chunk order.
+  [[nodiscard]] uint64_t HashCells() const;
+
+ private:
+  static constexpr int kChunkShift = 6;
+  static constexpr int kChunkMask = kChunkSize - 1;
+  static constexpr uint64_t kEvictionInterval = 64; // ticks between looks for idle chunks
+  static_assert(1 << kChunkShift == kChunkSize);
+
+  struct ChunkCoord {
+    int64_t x;
+    int64_t y;
+
+    bool operator==(const ChunkCoord&) const = default;
+  };
+
+  struct ChunkCoordHash {
+    size_t operator()(const ChunkCoord& coord) const {
+      return static_cast<size_t>(Random::Hash(static_cast<uint64_t>(coord.x), static_cast<uint64_t>(coord.y)));
+    }
+  };
+
+  struct Chunk {
+    explicit Chunk(const ChunkCoord coord) : coord(coord), cells(kChunkSize * kChunkSize) {}
+
+    ChunkCoord coord;
+    Layout cells;
+    int population = 0;  // cells that are not air
+    DirtyRect current;   // cells to visit this tick, in chunk coordinates
+    DirtyRect next;      // cells touched so far this tick, visited next tick
+    bool queued = false; // already in nextAwake
+    uint64_t lastUsed = 0; // tick it was last woken, touched or prefetched
+    int slot = -1;       // where the cells are parked while evicted
+  };
+
+  // A cell and the chunk holding it, which is null while that chunk is unallocated.
+  struct CellRef {
+    int64_t x;
+    int64_t y;
+    Chunk* chunk;
+    int index;
+  };
+
+  static inline ChunkCoord CoordOf(const int64_t x, const int64_t y) {
+    return {x >> kChunkShift, y >> kChunkShift};
+  }
+
+  // The chunk at coord, paged in, or null if there is none.
+  [[nodiscard]] Chunk* FindChunk(ChunkCoord coord);
+  // The chunk at coord as it is, evicted or not.
+  [[nodiscard]] Chunk* PeekChunk(ChunkCoord coord) const;
+  Chunk& AllocateChunk(ChunkCoord coord);
+
+  void PageIn(Chunk& chunk);
+  void PageOut(Chunk& chunk);
+  void EvictIdleChunks();
+
+  [[nodiscard]] CellRef Locate(int64_t x, int64_t y);
+  // The cell dx, dy away, without a lookup while it is in the same chunk.
+  [[nodiscard]] CellRef Offset(const CellRef& ref, int dx, int dy);
+
+  [[nodiscard]] inline bool IsEmpty(const CellRef& ref) const {
+    return !ref.chunk || Cell::GetType(ref.chunk->cells.GetElement(ref.index)) == Cell::Type::kEmpty;
+  }
+
+  // Moves the particle at from into to, allocating to's chunk if it has none.
+  void SwapCells(const CellRef& from, CellRef& to);
+  void WakeCell(const CellRef& ref);
+  void WakeRect(Chunk& chunk, int x0, int y0, int x1, int y1);
+
+  [[nodiscard]] inline int RandomBit(const int64_t x, const int64_t y) const {
+    return static_cast<int>(Random::Hash(tickKey ^ Random::Mix(static_cast<uint64_t>(y)), static_cast<uint64_t>(x)) >> 63);
+  }
+
+  void ApplyGravity(CellRef ref, int weight, int direction, bool liquid);
+  void ApplySpread(CellRef& ref, int spread, int direction);
+  void UpdateCell(Chunk& chunk, int index);
+  void FinishTick();
+
+  std::unordered_map<ChunkCoord, std::unique_ptr<Chunk>, ChunkCoordHash> chunks;
+  std::vector<Chunk*> awake;     // visited this tick, bottom to top then left to right
+  std::vector<Chunk*> nextAwake; // woken so far this tick
+
+  uint64_t tick = 0;
+  uint64_t seed = 0;
+  uint64_t tickKey = 0;
+  uint8_t generation = 1;
+
+  std::unique_ptr<ChunkStore> store; // null unless paging is enabled
+  uint64_t idleTicks = 0;
+  size_t evictedChunks = 0;
+  PagingStats pagingStats;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_SPARSE_WORLD_H_
@@ -0,0 +1,47 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_SPSC_QUEUE_H_
+#define RAYLIB_SAND_SIM_SRC_SPSC_QUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed size ring buffer between one producer thread and one consumer thread. Neither side takes
+// a lock or waits: Push fails when the queue is full and Pop when it is empty.
+template <typename T, size_t kCapacity>
+class SpscQueue {
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  // Producer side.
+  inline bool Push(const T& item) {
+    const size_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - head.load(std::memory_order_acquire) == kCapacity) {
+      return false;
+    }
+    items[tail & (kCapacity - 1)] = item;
+    this->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  inline bool Pop(T& item) {
+    const size_t head = this->head.load(std::memory_order_relaxed);
+    if (head == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[head & (kCapacity - 1)];
+    this->head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+  std::array<T, kCapacity> items{};
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_SPSC_QUEUE_H_
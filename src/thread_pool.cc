@@ -0,0 +1,75 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int threadCount) {
+  for (int i = 1; i < threadCount; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task) {
+  if (workers.empty() || count <= 1) {
+    for (int i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    job = &task;
+    jobCount = count;
+    nextTask.store(0, std::memory_order_relaxed);
+    busyWorkers = static_cast<int>(workers.size());
+    generation++;
+  }
+  wake.notify_all();
+
+  RunTasks();
+
+  std::unique_lock lock(mutex);
+  done.wait(lock, [this] { return busyWorkers == 0; });
+  job = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64_t seen = 0;
+  std::unique_lock lock(mutex);
+  while (true) {
+    wake.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping) {
+      return;
+    }
+    seen = generation;
+
+    lock.unlock();
+    RunTasks();
+    lock.lock();
+
+    if (--busyWorkers == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+void ThreadPool::RunTasks() {
+  // job and jobCount were published under the mutex before any thread got here
+  for (int i = nextTask.fetch_add(1, std::memory_order_relaxed); i < jobCount;
+       i = nextTask.fetch_add(1, std::memory_order_relaxed)) {
+    (*job)(i);
+  }
+}
@@ -0,0 +1,48 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_THREAD_POOL_H_
+#define RAYLIB_SAND_SIM_SRC_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of independent tasks. The calling thread
+// joins in on every batch, so a pool of N threads owns N-1 workers.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int threadCount);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  [[nodiscard]] inline int GetThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+  // Runs task(0) .. task(count-1) across the pool and returns once all of them have finished.
+  void ParallelFor(int count, const std::function<void(int)>& task);
+
+ private:
+  void WorkerLoop();
+  void RunTasks();
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+
+  const std::function<void(int)>* job = nullptr;
+  int jobCount = 0;
+  std::atomic<int> nextTask{0};
+  int busyWorkers = 0;
+  uint64_t generation = 0;
+  bool stopping = false;
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_THREAD_POOL_H_
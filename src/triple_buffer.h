@@ -0,0 +1,59 @@
+//
+// Created by Tom Smale on 16/10/2026.
+//
+
+#ifndef RAYLIB_SAND_SIM_SRC_TRIPLE_BUFFER_H_
+#define RAYLIB_SAND_SIM_SRC_TRIPLE_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Passes the latest of a stream of values from one writer thread to one reader thread without
+// either ever waiting on the other. The writer fills the back slot and publishes it; the reader
+// takes whichever slot was published last, and slots it never got to are simply overwritten.
+template <typename T>
+class TripleBuffer {
+ public:
+  explicit TripleBuffer(const T& initial) : slots{initial, initial, initial} {}
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Writer side: the slot to fill in next, and its index among the three.
+  inline T& GetBack() { return slots[back]; }
+  [[nodiscard]] inline int GetBackIndex() const { return back; }
+
+  // Writer side: hands the back slot to the reader and takes a free one in its place. Returns
+  // true when the slot published before this one was never taken, so whatever the reader was
+  // meant to learn from it has to be carried in the one just published.
+  inline bool Publish() {
+    const uint8_t previous = middle.exchange(back | kFresh, std::memory_order_acq_rel);
+    back = previous & kIndexMask;
+    return (previous & kFresh) != 0;
+  }
+
+  // Reader side: moves on to the latest published slot. Returns false, keeping the current one,
+  // when nothing has been published since the last call.
+  inline bool Acquire() {
+    if ((middle.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  // Reader side: the slot taken by the last Acquire.
+  [[nodiscard]] inline const T& GetFront() const { return slots[front]; }
+
+ private:
+  static constexpr uint8_t kIndexMask = 3;
+  static constexpr uint8_t kFresh = 4; // set while the middle slot hasn't been taken
+
+  std::array<T, 3> slots;
+  alignas(64) std::atomic<uint8_t> middle{1};
+  alignas(64) uint8_t back = 0; // writer only
+  alignas(64) uint8_t front = 2; // reader only
+};
+
+#endif //RAYLIB_SAND_SIM_SRC_TRIPLE_BUFFER_H_
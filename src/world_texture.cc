@@ -4,29 +4,98 @@
 
 #include "world_texture.h"
 
-void WorldTexture::Draw() {
-  for (int i = 0; i < worldWidth * worldHeight; i++) {
-    pixels[i] = particleColors[static_cast<int>(world[i])];
+#include <algorithm>
+#include <cmath>
+
+WorldTexture::WorldTexture(const WorldFrame& frame)
+    : width(frame.width),
+      height(frame.height),
+      colorKernel(Cell::GetShadePalette(), Cell::kShadePaletteSize) {
+  pixels = std::make_unique<Color[]>(width * height);
+  paletteIds.resize(width);
+  Convert(frame, { 0, 0, width - 1, height - 1 });
+  image = {
+      .data = pixels.get(),
+      .width = width,
+      .height = height,
+      .mipmaps = 1,
+      .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+  };
+  texture = LoadTextureFromImage(image);
+}
+
+WorldTexture::~WorldTexture() {
+  UnloadTexture(texture);
+}
+
+void WorldTexture::Update(const WorldFrame& frame) {
+  if (frame.changedRegions.empty()) {
+    return;
+  }
+
+  int changedArea = 0;
+  {
+    FrameProfiler::Scope timer(profiler, FrameProfiler::Phase::kConvert);
+    for (const AutomataMatrix::DirtyRect& region : frame.changedRegions) {
+      Convert(frame, region);
+      changedArea += region.Width() * region.Height();
+    }
   }
+  FrameProfiler::Scope timer(profiler, FrameProfiler::Phase::kUpload);
+  Upload(frame.changedRegions, changedArea);
+}
 
+void WorldTexture::Draw() const {
   // Calculate scaling factor based on window size and framebuffer size
-  float scaleFactorX = (float)GetScreenWidth() / worldWidth;
-  float scaleFactorY = (float)GetScreenHeight() / worldHeight;
+  float scaleFactorX = (float)GetScreenWidth() / width;
+  float scaleFactorY = (float)GetScreenHeight() / height;
 
   // Determine the smaller scale factor to maintain aspect ratio
   float scaleFactor = fminf(scaleFactorX, scaleFactorY);
 
-  float scaledWidth = worldWidth * scaleFactor;
-  float scaledHeight = worldHeight * scaleFactor;
+  float scaledWidth = width * scaleFactor;
+  float scaledHeight = height * scaleFactor;
   float offsetX = (GetScreenWidth() - scaledWidth) / 2.0f;
   float offsetY = (GetScreenHeight() - scaledHeight) / 2.0f;
 
   DrawTexturePro(
-      worldTexture,
-      (Rectangle){ 0, 0, (float)worldTexture.width, -(float)worldTexture.height }, // Source rectangle (inverted Y)
-      (Rectangle){ offsetX, offsetY, scaledWidth, scaledHeight },                  // Destination rectangle
-      (Vector2){ 0, 0 },                                                           // Origin
-      0.0f,                                                                        // Rotation
-      WHITE                                                                        // Tint
+      texture,
+      (Rectangle){ 0, 0, (float)texture.width, -(float)texture.height }, // Source rectangle (inverted Y)
+      (Rectangle){ offsetX, offsetY, scaledWidth, scaledHeight },        // Destination rectangle
+      (Vector2){ 0, 0 },                                                 // Origin
+      0.0f,                                                              // Rotation
+      WHITE                                                              // Tint
   );
 }
+
+void WorldTexture::Convert(const WorldFrame& frame, const AutomataMatrix::DirtyRect& region) {
+  const int regionWidth = region.Width();
+  for (int y = region.minY; y <= region.maxY; y++) {
+    const Cell::Element* row = &frame.elements[y*width + region.minX];
+    const uint8_t* shades = &frame.shades[y*width + region.minX];
+    for (int x = 0; x < regionWidth; x++) {
+      paletteIds[x] = static_cast<uint8_t>(static_cast<int>(row[x]) * Cell::kShadeCount + shades[x]);
+    }
+    colorKernel.ConvertRow(paletteIds.data(), &pixels[y*width + region.minX], regionWidth);
+  }
+}
+
+void WorldTexture::Upload(const std::vector<AutomataMatrix::DirtyRect>& regions, const int changedArea) {
+  // past a certain point one big upload is cheaper than many small ones
+  if (changedArea * 2 > width * height) {
+    UpdateTexture(texture, pixels.get());
+    return;
+  }
+
+  // UpdateTextureRec wants the rectangle's pixels packed together
+  for (const AutomataMatrix::DirtyRect& region : regions) {
+    const int regionWidth = region.Width();
+    uploadPixels.resize(regionWidth * region.Height());
+    for (int y = region.minY; y <= region.maxY; y++) {
+      std::copy_n(&pixels[y*width + region.minX], regionWidth, &uploadPixels[(y - region.minY) * regionWidth]);
+    }
+    UpdateTextureRec(texture,
+                     (Rectangle){ (float)region.minX, (float)region.minY, (float)regionWidth, (float)region.Height() },
+                     uploadPixels.data());
+  }
+}
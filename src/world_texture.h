@@ -6,55 +6,48 @@
 #define RAYLIB_SAND_SIM_SRC_WORLD_TEXTURE_H_
 
 #include <raylib.h>
-#include <memory.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
+#include "color_kernel.h"
+#include "frame_profiler.h"
+#include "simulation_thread.h"
+
+// Owns the pixels and GPU texture the world is drawn from. Each frame published by the
+// simulation is converted to pixels once, a palette lookup per cell by element and shade; every
+// draw in between reuses the last conversion.
 class WorldTexture {
  public:
-  WorldTexture(int textureWidth, int textureHeight) : width(textureWidth), height(textureHeight) {
-    pixels = std::make_unique<Color[]>(width * height);
-    image = {
-        .data = nullptr,
-        .width = width,
-        .height = height,
-        .mipmaps = 1,
-        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
-    };
-    texture = LoadTextureFromImage(image);
-  }
-
-  void Draw() {
-    for (int i = 0; i < width * height; i++) {
-      pixels[i] = particleColors[static_cast<int>(world[i])];
-    }
-
-    // Calculate scaling factor based on window size and framebuffer size
-    float scaleFactorX = (float)GetScreenWidth() / width;
-    float scaleFactorY = (float)GetScreenHeight() / height;
-
-    // Determine the smaller scale factor to maintain aspect ratio
-    float scaleFactor = fminf(scaleFactorX, scaleFactorY);
-
-    float scaledWidth = width * scaleFactor;
-    float scaledHeight = height * scaleFactor;
-    float offsetX = (GetScreenWidth() - scaledWidth) / 2.0f;
-    float offsetY = (GetScreenHeight() - scaledHeight) / 2.0f;
-
-    DrawTexturePro(
-        texture,
-        (Rectangle){ 0, 0, (float)worldTexture.width, -(float)worldTexture.height }, // Source rectangle (inverted Y)
-        (Rectangle){ offsetX, offsetY, scaledWidth, scaledHeight },                  // Destination rectangle
-        (Vector2){ 0, 0 },                                                           // Origin
-        0.0f,                                                                        // Rotation
-        WHITE                                                                        // Tint
-    );
-  }
+  explicit WorldTexture(const WorldFrame& frame);
+  ~WorldTexture();
+
+  WorldTexture(const WorldTexture&) = delete;
+  WorldTexture& operator=(const WorldTexture&) = delete;
+
+  // Recolors and uploads the regions the frame says changed since the last one converted.
+  void Update(const WorldFrame& frame);
+
+  // Draws the texture scaled to fit the window, keeping its aspect ratio.
+  void Draw() const;
+
+  // Times conversion and upload in profiler from now on; null stops timing them.
+  inline void SetProfiler(FrameProfiler* profiler) { this->profiler = profiler; }
 
  private:
+  void Convert(const WorldFrame& frame, const AutomataMatrix::DirtyRect& region);
+  void Upload(const std::vector<AutomataMatrix::DirtyRect>& regions, int changedArea);
+
   int width;
   int height;
   std::unique_ptr<Color[]> pixels;
   Image image;
   Texture2D texture;
+  ColorKernel colorKernel; // over Cell's shade palette
+  std::vector<uint8_t> paletteIds; // a row of element and shade turned into palette entries
+
+  std::vector<Color> uploadPixels;
+  FrameProfiler* profiler = nullptr;
 };
 
 #endif //RAYLIB_SAND_SIM_SRC_WORLD_TEXTURE_H_